@@ -0,0 +1,39 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "xdlg.h"
+#include "assuan.h"
+#include "trace.h"
+#include "secmem.h"
+
+//----------------------------------------------------------------------
+// Only the ssh-askpass interface: the prompt is the last argument, the
+// display comes from the environment, and the passphrase is printed to
+// stdout. Built instead of pinentry.c, without the Assuan commands,
+// the daemon, or the keyring cache; see the Makefile.
+
+int main (int argc, char* argv[])
+{
+    TracePhase (phase_Exec);
+    if (!SecmemInit()) {
+	fputs ("Error: unable to allocate secure memory\n", stderr);
+	return EXIT_FAILURE;
+    }
+    if (argc > 1)
+	_description = argv[argc-1];
+    _argc = argc;
+    _argv = (const char* const*) argv;
+    if (RunMainDialog()) {
+	ReplyLine (_password);
+	FlushReplies();
+    }
+    return EXIT_SUCCESS;
+}
+
+// There is no protocol input to read while the dialog is open
+edlginput_t OnDialogInput (void)
+{
+    return dlginput_Continue;
+}
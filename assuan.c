@@ -0,0 +1,208 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "assuan.h"
+#include "secmem.h"
+#include "codec.h"
+#include <stdarg.h>
+#include <errno.h>
+
+//----------------------------------------------------------------------
+
+enum {
+    REPLY_BUFSZ = 4096,
+    INPUT_BUFSZ_POW = 11,
+    INPUT_BUFSZ = 1<<INPUT_BUFSZ_POW	// Must hold at least one line
+};
+
+static char* _reply = NULL;	// In the secure arena, as are the input buffer
+static size_t _replyLen = 0;
+static char* _held = NULL;	// Replies held while a dialog is open
+static size_t _heldLen = 0;
+static bool _holding = false;
+
+static char* _input = NULL;
+static size_t _inputHead = 0;	// Monotonically increasing, masked on access
+static size_t _inputTail = 0;
+static size_t _inputScan = 0;	// Where to continue looking for the newline
+static bool _inputEOF = false;
+
+//----------------------------------------------------------------------
+// Reply output
+
+static void ReplyAppend (const char* s, size_t n)
+{
+    if (_holding) {
+	// Never overflows, with commands only run when CanHoldReply
+	if (!_held && !(_held = SecmemKeep (REPLY_BUFSZ)))
+	    return;
+	if (n > REPLY_BUFSZ-_heldLen)
+	    n = REPLY_BUFSZ-_heldLen;
+	memcpy (&_held[_heldLen], s, n);
+	_heldLen += n;
+	return;
+    }
+    if (!_reply && !(_reply = SecmemKeep (REPLY_BUFSZ)))
+	return;
+    while (_replyLen+n > REPLY_BUFSZ) {
+	// Only large data replies get here; flush early and continue
+	const size_t part = REPLY_BUFSZ-_replyLen;
+	memcpy (&_reply[_replyLen], s, part);
+	_replyLen += part;
+	s += part;
+	n -= part;
+	FlushReplies();
+    }
+    memcpy (&_reply[_replyLen], s, n);
+    _replyLen += n;
+}
+
+void ReplyLine (const char* line)
+{
+    ReplyAppend (STRBLK(line));
+    ReplyAppend ("\n", 1);
+}
+
+void ReplyF (const char* fmt, ...)
+{
+    char line [ASSUAN_LINE_LIMIT+2];
+    va_list args;
+    va_start (args, fmt);
+    int n = vsnprintf (line, sizeof(line), fmt, args);
+    va_end (args);
+    if (n > 0)
+	ReplyAppend (line, (size_t) n < sizeof(line) ? (size_t) n : sizeof(line)-1);
+}
+
+void ReplyData (const char* s, size_t n)
+{
+    // Escaped data is written in as many D lines as needed to stay within the line limit.
+    // Empty data is one empty D line, so an empty passphrase is not a missing one.
+    char line [ASSUAN_LINE_LIMIT+2] = "D ";
+    do {
+	size_t used;
+	size_t ll = 2 + PercentEscape (&line[2], ASSUAN_LINE_LIMIT-2, s, n, &used);
+	line[ll++] = '\n';
+	ReplyAppend (line, ll);
+	s += used;
+	n -= used;
+    } while (n);
+    memset (line, 0, sizeof(line));
+}
+
+bool FlushReplies (void)
+{
+    bool ok = true;
+    for (const char* p = _reply; p < &_reply[_replyLen];) {
+	ssize_t bw = write (STDOUT_FILENO, p, &_reply[_replyLen]-p);
+	if (bw < 0 && errno == EINTR)
+	    continue;
+	if (bw <= 0) {
+	    ok = false;
+	    break;
+	}
+	p += bw;
+    }
+    DiscardReplies();
+    return ok;
+}
+
+void DiscardReplies (void)
+{
+    memset (_reply, 0, _replyLen);
+    _replyLen = 0;
+}
+
+bool CanHoldReply (void)
+{
+    // Room for the longest reply to a command allowed in a dialog,
+    // which is a data line and OK
+    return _heldLen + 2*(ASSUAN_LINE_LIMIT+2) <= REPLY_BUFSZ;
+}
+
+void HoldReplies (bool hold)
+{
+    _holding = hold;
+}
+
+void ReleaseHeldReplies (void)
+{
+    if (!_heldLen)
+	return;
+    ReplyAppend (_held, _heldLen);
+    memset (_held, 0, _heldLen);
+    _heldLen = 0;
+}
+
+//----------------------------------------------------------------------
+// Command input
+
+void ResetCommandInput (void)
+{
+    if (_input || (_input = SecmemKeep (INPUT_BUFSZ)))
+	memset (_input, 0, INPUT_BUFSZ);
+    _inputHead = _inputTail = _inputScan = 0;
+    _inputEOF = false;
+}
+
+static size_t FindLineEnd (void)
+{
+    // Returns the offset past the newline from _inputHead, or 0 if there is no complete line
+    for (; _inputScan < _inputTail; ++_inputScan)
+	if (_input[_inputScan%INPUT_BUFSZ] == '\n')
+	    return _inputScan+1-_inputHead;
+    return 0;
+}
+
+static bool IsCommandLineTooLong (void)
+{
+    return _inputTail-_inputHead > ASSUAN_LINE_LIMIT;
+}
+
+bool IsCommandLinePending (void)
+{
+    // A line, or an error to report instead of one
+    return FindLineEnd() || _inputEOF || IsCommandLineTooLong();
+}
+
+void ReadCommandInput (void)
+{
+    if (_inputEOF || IsCommandLineTooLong())
+	return;
+    // Read into the contiguous free part of the ring
+    const size_t tail = _inputTail % INPUT_BUFSZ, head = _inputHead % INPUT_BUFSZ;
+    const size_t space = tail >= head ? INPUT_BUFSZ-tail : head-tail;
+    ssize_t br;
+    do {
+	br = read (STDIN_FILENO, &_input[tail], space);
+    } while (br < 0 && errno == EINTR);
+    if (br <= 0)
+	_inputEOF = true;
+    else
+	_inputTail += br;
+}
+
+int ReadCommandLine (char line [ASSUAN_LINE_LIMIT+2])
+{
+    size_t ll;
+    while (!(ll = FindLineEnd())) {
+	if (IsCommandLineTooLong())
+	    return readline_TooLong;
+	if (_inputEOF)
+	    return readline_EOF;
+	ReadCommandInput();
+    }
+    if (ll > ASSUAN_LINE_LIMIT+1)
+	return readline_TooLong;
+    for (size_t i = 0; i < ll; ++i) {
+	char* c = &_input[(_inputHead+i) % INPUT_BUFSZ];
+	line[i] = *c;
+	*c = 0;	// Wipe as it is consumed
+    }
+    line[ll] = 0;
+    _inputHead += ll;
+    _inputScan = _inputHead;
+    return readline_Ok;
+}
@@ -0,0 +1,39 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "config.h"
+#include <stdbool.h>
+
+//----------------------------------------------------------------------
+// Replies are collected in a fixed buffer and written to stdout at once
+// when a command completes. The buffer is wiped after each write, so
+// secrets do not linger in stdio buffers.
+
+void ReplyLine (const char* line);
+void ReplyF (const char* fmt, ...) __attribute__((format(printf,1,2)));
+void ReplyData (const char* s, size_t n);
+bool FlushReplies (void);
+void DiscardReplies (void);
+
+// Replies to commands run while a dialog is open are held back until
+// the command that opened it has replied, so they stay in command order.
+bool CanHoldReply (void);
+void HoldReplies (bool hold);
+void ReleaseHeldReplies (void);
+
+//----------------------------------------------------------------------
+// Commands are read from stdin with read() into a ring buffer
+
+enum {
+    readline_TooLong = -1,
+    readline_EOF,
+    readline_Ok
+};
+
+void ResetCommandInput (void);
+void ReadCommandInput (void);
+bool IsCommandLinePending (void);
+int ReadCommandLine (char line [ASSUAN_LINE_LIMIT+2]);
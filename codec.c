@@ -0,0 +1,75 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "codec.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+//----------------------------------------------------------------------
+
+static const char c_HexChars[] = "0123456789ABCDEF";
+
+static bool NeedsEscape (unsigned char c);
+static int HexValue (char c);
+
+//----------------------------------------------------------------------
+
+size_t PercentEscape (char* d, size_t dsz, const char* s, size_t n, size_t* used)
+{
+    size_t di = 0, si = 0;
+    for (; si < n; ++si) {
+	const unsigned char c = s[si];
+	if (!NeedsEscape (c)) {
+	    if (di >= dsz)
+		break;
+	    d[di++] = c;
+	} else {
+	    if (di+3 > dsz)
+		break;	// Escapes are not split across lines
+	    d[di++] = '%';
+	    d[di++] = c_HexChars[c>>4];
+	    d[di++] = c_HexChars[c&0xf];
+	}
+    }
+    *used = si;
+    return di;
+}
+
+size_t PercentUnescape (char* d, const char* s, size_t n)
+{
+    // d never gets ahead of s, so this works in place
+    size_t di = 0;
+    for (size_t i = 0; i < n; ++i) {
+	char c = s[i];
+	int hnib, lnib;
+	if (c == '%' && i+2 < n && 0 <= (hnib = HexValue (s[i+1])) && 0 <= (lnib = HexValue (s[i+2]))) {
+	    c = (hnib<<4)|lnib;
+	    i += 2;
+	}
+	d[di++] = c;
+    }
+    d[di] = 0;
+    return di;
+}
+
+static bool NeedsEscape (unsigned char c)
+{
+    // Bit set of bytes escaped in data lines: controls, '%', and DEL and above
+    static const uint32_t c_EscapeSet [256/32] = {
+	0xffffffff, 1u<<('%'-0x20), 0, 1u<<(0x7f-0x60),
+	0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff
+    };
+    return c_EscapeSet[c/32] & (1u<<(c%32));
+}
+
+static int HexValue (char c)
+{
+    if (c >= '0' && c <= '9')
+	return c-'0';
+    c |= 0x20;	// lowercase
+    if (c >= 'a' && c <= 'f')
+	return c-'a'+10;
+    return -1;
+}
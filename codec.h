@@ -0,0 +1,21 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "config.h"
+
+//----------------------------------------------------------------------
+// Assuan percent escaping, one pass over the input each way. Data lines
+// escape controls, '%', and bytes from DEL up; command arguments have
+// each valid %XX replaced by its byte, and anything else kept as is.
+
+// Escapes s[n] into d until the next byte or escape would not fit in
+// dsz bytes, which must be at least 3. Returns the bytes written, and
+// the bytes of s read in *used.
+size_t PercentEscape (char* d, size_t dsz, const char* s, size_t n, size_t* used);
+
+// Unescapes s[n] into d, which may be s, and terminates it with a zero.
+// Returns the unescaped length.
+size_t PercentUnescape (char* d, const char* s, size_t n);
@@ -0,0 +1,38 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "command.h"
+
+//----------------------------------------------------------------------
+
+static const char c_CmdNames [cmd_NCMDS][CMD_MAXLEN+1] = {	// Parallel to ECmd
+    #define CMD(name,slot)	#name,
+    #include "cmds.h"
+    #undef CMD
+};
+
+// Slots are those computed by mkcmds.awk with CMD_HASH. Their
+// contents are ECmd+1, leaving 0 for empty slots.
+static const unsigned char c_CmdSlots [CMD_NSLOTS] = {
+    #define CMD(name,slot)	[slot] = cmd_##name+1,
+    #include "cmds.h"
+    #undef CMD
+};
+
+//----------------------------------------------------------------------
+
+enum ECmd MatchCommand (strblk_t t)
+{
+    if (t.n < CMD_MINLEN || t.n > CMD_MAXLEN)
+	return cmd_NCMDS;
+    const unsigned char* c = (const unsigned char*) t.p;
+    unsigned slot = c_CmdSlots [CMD_HASH (c[0], c[t.n-2], c[t.n-1], t.n)];
+    if (!slot--)
+	return cmd_NCMDS;
+    // Exact match is still needed; the hash only picks the candidate
+    if (c_CmdNames[slot][t.n] || 0 != strncasecmp (c_CmdNames[slot], t.p, t.n))
+	return cmd_NCMDS;
+    return slot;
+}
@@ -0,0 +1,22 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "xdlg.h"
+
+//----------------------------------------------------------------------
+
+// Assuan commands, in the order listed in cmds.txt
+enum ECmd {
+    #define CMD(name,slot)	cmd_##name,
+    #include "cmds.h"
+    #undef CMD
+    cmd_NCMDS
+};
+
+//----------------------------------------------------------------------
+
+// Returns the command named by t in any case, or cmd_NCMDS if none is
+enum ECmd MatchCommand (strblk_t t);
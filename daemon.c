@@ -0,0 +1,208 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "daemon.h"
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+
+//----------------------------------------------------------------------
+
+static bool SocketPath (struct sockaddr_un* addr);
+static bool IsPeerSelf (int fd);
+static int ConnectToDaemon (void);
+static bool WriteAll (int fd, const char* buf, size_t n);
+static ssize_t ReadLine (int fd, char* line, size_t linesz);
+
+//----------------------------------------------------------------------
+// Socket setup
+
+static bool SocketPath (struct sockaddr_un* addr)
+{
+    memset (addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    const char* rundir = getenv ("XDG_RUNTIME_DIR");
+    int r;
+    if (rundir && rundir[0])
+	r = snprintf (addr->sun_path, sizeof(addr->sun_path), "%s/" PINENTRY_NAME ".sock", rundir);
+    else
+	r = snprintf (addr->sun_path, sizeof(addr->sun_path), "/tmp/" PINENTRY_NAME "-%u.sock", getuid());
+    return r > 0 && (size_t) r < sizeof(addr->sun_path);
+}
+
+static bool IsPeerSelf (int fd)
+{
+    // Both sides check this; the socket may be in a world-writable directory
+    struct ucred cred;
+    socklen_t credlen = sizeof(cred);
+    return 0 == getsockopt (fd, SOL_SOCKET, SO_PEERCRED, &cred, &credlen) && cred.uid == getuid();
+}
+
+static int ConnectToDaemon (void)
+{
+    struct sockaddr_un addr;
+    if (!SocketPath (&addr))
+	return -1;
+    int fd = socket (AF_UNIX, SOCK_STREAM| SOCK_CLOEXEC, 0);
+    if (fd < 0)
+	return -1;
+    if (0 != connect (fd, (const struct sockaddr*) &addr, sizeof(addr)) || !IsPeerSelf (fd)) {
+	close (fd);
+	return -1;
+    }
+    return fd;
+}
+
+static bool WriteAll (int fd, const char* buf, size_t n)
+{
+    while (n) {
+	ssize_t bw = write (fd, buf, n);
+	if (bw < 0 && errno == EINTR)
+	    continue;
+	if (bw <= 0)
+	    return false;
+	buf += bw;
+	n -= bw;
+    }
+    return true;
+}
+
+static ssize_t ReadLine (int fd, char* line, size_t linesz)
+{
+    // Only used for the few handshake lines, so reading one byte at a time is fine
+    size_t n = 0;
+    while (n < linesz-1) {
+	ssize_t br = read (fd, &line[n], 1);
+	if (br < 0 && errno == EINTR)
+	    continue;
+	if (br <= 0)
+	    return -1;
+	if (line[n++] == '\n')
+	    break;
+    }
+    line[n] = 0;
+    return n;
+}
+
+//----------------------------------------------------------------------
+// Server side
+
+bool RunDaemon (void (*session)(void))
+{
+    // Refuse to start if another daemon is already listening
+    int ofd = ConnectToDaemon();
+    if (ofd >= 0) {
+	close (ofd);
+	return false;
+    }
+    struct sockaddr_un addr;
+    if (!SocketPath (&addr))
+	return false;
+    int sfd = socket (AF_UNIX, SOCK_STREAM| SOCK_CLOEXEC, 0);
+    if (sfd < 0)
+	return false;
+    unlink (addr.sun_path);	// Remove the stale socket left by a dead daemon
+    mode_t omask = umask (S_IRWXG| S_IRWXO);
+    bool listening = 0 == bind (sfd, (const struct sockaddr*) &addr, sizeof(addr)) && 0 == listen (sfd, SOMAXCONN);
+    umask (omask);
+    int nullfd = open ("/dev/null", O_RDWR| O_CLOEXEC);
+    if (!listening || nullfd < 0) {
+	close (sfd);
+	return false;
+    }
+    // Closed clients must not kill the daemon; write errors end the session instead
+    signal (SIGPIPE, SIG_IGN);
+    dup2 (nullfd, STDIN_FILENO);
+    dup2 (nullfd, STDOUT_FILENO);
+
+    for (;;) {
+	int cfd = accept4 (sfd, NULL, NULL, SOCK_CLOEXEC);
+	if (cfd < 0) {
+	    if (errno == EINTR || errno == ECONNABORTED)
+		continue;
+	    break;
+	}
+	if (IsPeerSelf (cfd) && 0 <= dup2 (cfd, STDIN_FILENO) && 0 <= dup2 (cfd, STDOUT_FILENO))
+	    session();
+	// The client only sees EOF when all copies of the socket are closed
+	dup2 (nullfd, STDIN_FILENO);
+	dup2 (nullfd, STDOUT_FILENO);
+	close (cfd);
+    }
+    close (nullfd);
+    close (sfd);
+    return false;
+}
+
+//----------------------------------------------------------------------
+// Client side
+
+bool ForwardToDaemon (const char* preamble)
+{
+    int fd = ConnectToDaemon();
+    if (fd < 0)
+	return false;
+
+    // The greeting is held back until the preamble options are applied,
+    // so gpg-agent sees only the replies to its own commands.
+    char greeting [ASSUAN_LINE_LIMIT+2];
+    if (0 >= ReadLine (fd, greeting, sizeof(greeting)) || 0 != strncmp (greeting, "OK", 2)) {
+	close (fd);
+	return false;
+    }
+    if (preamble && preamble[0]) {
+	if (!WriteAll (fd, STRBLK(preamble))) {
+	    close (fd);
+	    return false;
+	}
+	char reply [ASSUAN_LINE_LIMIT+2];
+	for (const char* l = preamble; (l = strchr (l, '\n')); ++l) {
+	    do {
+		if (0 >= ReadLine (fd, reply, sizeof(reply))) {
+		    close (fd);
+		    return false;
+		}
+	    } while (0 != strncmp (reply, "OK", 2) && 0 != strncmp (reply, "ERR", 3));
+	}
+    }
+    if (!WriteAll (STDOUT_FILENO, STRBLK(greeting))) {
+	close (fd);
+	return true;
+    }
+
+    // Relay until the daemon closes the session
+    struct pollfd pfd[2] = {
+	{ .fd = STDIN_FILENO, .events = POLLIN },
+	{ .fd = fd, .events = POLLIN }
+    };
+    char buf [BUFSIZ];
+    for (;;) {
+	if (0 > poll (pfd, 2, -1)) {
+	    if (errno == EINTR)
+		continue;
+	    break;
+	}
+	if (pfd[1].revents) {
+	    ssize_t br = read (fd, buf, sizeof(buf));
+	    if (br <= 0 || !WriteAll (STDOUT_FILENO, buf, br))
+		break;
+	}
+	if (pfd[0].revents) {
+	    ssize_t br = read (STDIN_FILENO, buf, sizeof(buf));
+	    if (br <= 0) {
+		shutdown (fd, SHUT_WR);
+		pfd[0].fd = -1;	// Keep reading replies to commands already sent
+	    } else if (!WriteAll (fd, buf, br))
+		break;
+	}
+    }
+    memset (buf, 0, sizeof(buf));	// Passphrases were relayed through it
+    close (fd);
+    return true;
+}
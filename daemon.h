@@ -0,0 +1,20 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "config.h"
+#include <stdbool.h>
+
+//----------------------------------------------------------------------
+
+// Listens on the per-user socket, running session() for each
+// connection with stdin and stdout redirected to it. Only returns
+// if the socket could not be created.
+bool RunDaemon (void (*session)(void));
+
+// Connects to a running daemon and relays stdin and stdout to it.
+// preamble lines are sent first, and their replies discarded.
+// Returns false if no daemon is running.
+bool ForwardToDaemon (const char* preamble);
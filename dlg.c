@@ -0,0 +1,184 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "xdlg.h"
+#include "trace.h"
+#include "stats.h"
+#include "secmem.h"
+#include "assuan.h"
+#include "quality.h"
+
+//----------------------------------------------------------------------
+// Extern interface set from main
+
+int _argc = 0;
+const char* const* _argv = NULL;
+const char* _displayName = NULL;
+
+edlgtype_t _dialogType = PromptForPassword;
+const char* _description = DEFAULT_DESCRIPTION;
+char _prompt [PROMPT_MAXLEN] = DEFAULT_PASSWORD_PROMPT;
+unsigned _confirms = 0;
+unsigned _parentWindow = 0;
+unsigned _entryTimeout = 0;
+bool _nograb = false;
+bool _noServerGrab = false;
+int _inputFd = -1;
+const char* _errorText = NULL;
+
+char* _password = NULL;
+size_t _passwordLen = 0;
+
+// Entry runtime information
+char _confirmPrompt [PROMPT_MAXLEN] = "";
+char* _confirmBuf = NULL;
+size_t _confirmBufLen = 0;
+unsigned _confirmsPass = 0;
+bool _accepted = false;
+bool _dialogFailed = false;
+
+const char* _multiDesc [MULTI_MAX] = { NULL };
+unsigned _multiCount = 0;
+unsigned _multiIndex = 0;
+char* _multiPasswords = NULL;
+size_t _multiLen [MULTI_MAX] = { 0 };
+unsigned long _serverGrabUsec = 0;
+unsigned long _framesSaved = 0;
+
+//----------------------------------------------------------------------
+
+static const dlgbackend_t* _backend = NULL;
+
+static void SelectBackend (void);
+static void CloseDialogs (void);
+
+//----------------------------------------------------------------------
+
+static void SelectBackend (void)
+{
+    // A keystroke script replaces the display, for testing without X
+    if (getenv ("PINENTRY_XLIB_SCRIPT") || getenv ("PINENTRY_XLIB_SCRIPT_FILE"))
+	_backend = &c_HeadlessBackend;
+    else
+	_backend = &c_XBackend;
+    atexit (CloseDialogs);
+}
+
+static void CloseDialogs (void)
+{
+    _backend->Close();
+}
+
+bool KeepEntryBuffers (void)
+{
+    if (!_password && (!(_password = SecmemKeep (PASSWORD_MAXLEN)) || !(_confirmBuf = SecmemKeep (PASSWORD_MAXLEN))))
+	_password = NULL;
+    return _password;
+}
+
+bool RunMainDialog (void)
+{
+    TracePhase (phase_Dialog);
+    _dialogFailed = false;
+    if (!KeepEntryBuffers()
+	    || (_dialogType == PromptForPasswords && !_multiPasswords && !(_multiPasswords = SecmemKeep (MULTI_MAX*PASSWORD_MAXLEN)))) {
+	ReplyLine ("ERR 83918934 out of core");
+	_dialogFailed = true;
+	return false;
+    }
+    if (!_backend)
+	SelectBackend();
+    QualityUpdate (_password, _passwordLen);	// The password may have been cleared since
+    if (!_backend->Open())
+	return false;
+    const bool r = _backend->RunDialog() && _accepted;
+    // Reset for next time; a cancelled dialog may be in mid-confirmation
+    _accepted = false;
+    _confirmsPass = 0;
+    _confirmBufLen = 0;
+    memset (_confirmBuf, 0, PASSWORD_MAXLEN);
+    _multiIndex = 0;
+    return r;
+}
+
+void PrewarmDialog (void)
+{
+    if (!_backend)
+	SelectBackend();
+    if (_backend->Prewarm)
+	_backend->Prewarm();
+}
+
+void FinishPrewarmDialog (void)
+{
+    if (_backend && _backend->FinishPrewarm)
+	_backend->FinishPrewarm();
+}
+
+const char* DialogRenderPath (void)
+{
+    // The path is chosen when the window is created, maybe by the prewarm
+    FinishPrewarmDialog();
+    return _backend ? _backend->RenderPath() : "none";
+}
+
+//----------------------------------------------------------------------
+// Entry logic
+
+unsigned ComputeQuality (void)
+{
+    // Kept current by OnKey, scoring one character per key
+    unsigned passwordBits = QualityBits();
+    return passwordBits > MAX_QUALITY ? MAX_QUALITY : passwordBits;
+}
+
+bool OnKey (unsigned k)
+{
+    ++_stats.keys;
+    if (k == key_Return && _dialogType == PromptForPasswords) {
+	// Move the entered passphrase out and start on the next one
+	memcpy (&_multiPasswords[_multiIndex*PASSWORD_MAXLEN], _password, PASSWORD_MAXLEN);
+	_multiLen[_multiIndex] = _passwordLen;
+	memset (_password, _passwordLen = 0, PASSWORD_MAXLEN);
+	QualityUpdate (_password, _passwordLen);
+	return _accepted = ++_multiIndex >= _multiCount;
+    } else if (k == key_Return) {
+	if (_confirmsPass++ && 0 != memcmp (_password, _confirmBuf, _passwordLen))
+	    ++_confirms;	// Ask again if does not match
+	const char* confirmfmt = _confirms > 1 ? MULTI_CONFIRM_PROMPT : SINGLE_CONFIRM_PROMPT;
+	snprintf (_confirmPrompt, sizeof(_confirmPrompt), confirmfmt, _confirmsPass);
+	memset (_confirmBuf, 0, PASSWORD_MAXLEN);
+	_confirmBufLen = 0;
+	if (_confirmsPass > _confirms) {
+	    _confirmsPass = 0;
+	    return _accepted = true;
+	}
+    } else if (k == key_Escape) {
+	_password[_passwordLen = 0] = 0;
+	return true;
+    } else if (k == key_BackSpace || k == key_Delete) {
+	if (_confirmsPass > 0) {
+	    if (_confirmBufLen > 0)
+		_confirmBuf[--_confirmBufLen] = 0;
+	} else if (_passwordLen > 0) {
+	    _password[--_passwordLen] = 0;
+	    QualityUpdate (_password, _passwordLen);
+	}
+    } else if (k >= ' ' && k <= '~') {
+	if (_confirmsPass > 0) {
+	    if (_confirmBufLen < PASSWORD_MAXLEN-1) {
+		_confirmBuf[_confirmBufLen] = k;
+		_confirmBuf[++_confirmBufLen] = 0;
+	    }
+	} else {
+	    if (_passwordLen < PASSWORD_MAXLEN-1) {
+		_password[_passwordLen] = k;
+		_password[++_passwordLen] = 0;
+		QualityUpdate (_password, _passwordLen);
+	    }
+	}
+    }
+    return false;
+}
@@ -0,0 +1,167 @@
+// Glyph bitmaps of the built-in font, printable ASCII from DejaVu Sans
+// Mono 2.37 (DejaVuSansMono.ttf, https://dejavu-fonts.github.io),
+// rendered once with FreeType at 17 pixels with monochrome hinting into
+// 10x20 cells. DejaVu is derived from Bitstream Vera, so this data is
+// under the Bitstream Vera license below, not the MIT License of the
+// rest of pinentry-xlib.
+//
+// Copyright (c) 2003 by Bitstream, Inc. All Rights Reserved. Bitstream
+// Vera is a trademark of Bitstream, Inc. DejaVu changes are in public domain.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of the fonts accompanying this license ("Fonts") and associated
+// documentation files (the "Font Software"), to reproduce and distribute
+// the Font Software, including without limitation the rights to use, copy,
+// merge, publish, distribute, and/or sell copies of the Font Software, and
+// to permit persons to whom the Font Software is furnished to do so,
+// subject to the following conditions:
+//
+// The above copyright and trademark notices and this permission notice
+// shall be included in all copies of one or more of the Font Software
+// typefaces.
+//
+// The Font Software may be modified, altered, or added to, and in
+// particular the designs of glyphs or characters in the Fonts may be
+// modified and additional glyphs or characters may be added to the Fonts,
+// only if the fonts are renamed to names not containing either the words
+// "Bitstream" or the word "Vera".
+//
+// This License becomes null and void to the extent applicable to Fonts or
+// Font Software that has been modified and is distributed under the
+// "Bitstream Vera" names.
+//
+// The Font Software may be sold as part of a larger software package but
+// no copy of one or more of the Font Software typefaces may be sold by
+// itself.
+//
+// THE FONT SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO ANY WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT OF
+// COPYRIGHT, PATENT, TRADEMARK, OR OTHER RIGHT. IN NO EVENT SHALL
+// BITSTREAM OR THE GNOME FOUNDATION BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, INCLUDING ANY GENERAL, SPECIAL, INDIRECT, INCIDENTAL,
+// OR CONSEQUENTIAL DAMAGES, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+// OTHERWISE, ARISING FROM, OUT OF THE USE OR INABILITY TO USE THE FONT
+// SOFTWARE OR FROM OTHER DEALINGS IN THE FONT SOFTWARE.
+//
+// Except as contained in this notice, the names of Gnome, the Gnome
+// Foundation, and Bitstream Inc., shall not be used in advertising or
+// otherwise to promote the sale, use or other dealings in this Font
+// Software without prior written authorization from the Gnome Foundation
+// or Bitstream Inc., respectively. For further information, contact:
+// fonts at gnome dot org.
+
+#pragma once
+#include <stdint.h>
+
+//----------------------------------------------------------------------
+
+enum {
+    FONT_W = 10,	// Every glyph advances by the cell width
+    FONT_H = 20,
+    FONT_ASCENT = 15,
+    FONT_FIRST = ' ',
+    FONT_N = '~'+1-FONT_FIRST
+};
+
+//{{{ c_FontGlyphs - rows of each glyph, top down
+// Each row is a bitmask of pixels, the leftmost in the low bit, which
+// is the order of XBM data, so the rows can be uploaded as is.
+static const uint16_t c_FontGlyphs [FONT_N][FONT_H] = {
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000 },	// space
+    { 0x000,0x000,0x000,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x000,0x000,0x030,0x030,0x000,0x000,0x000,0x000,0x000 },	// !
+    { 0x000,0x000,0x000,0x048,0x048,0x048,0x048,0x048,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000 },	// "
+    { 0x000,0x000,0x000,0x000,0x190,0x090,0x090,0x3fe,0x0c8,0x048,0x048,0x1ff,0x064,0x024,0x026,0x000,0x000,0x000,0x000,0x000 },	// #
+    { 0x000,0x000,0x020,0x020,0x078,0x0ac,0x02c,0x02c,0x03c,0x0f8,0x1e0,0x1a0,0x1a0,0x1a4,0x0f8,0x020,0x020,0x020,0x000,0x000 },	// $
+    { 0x000,0x000,0x000,0x00e,0x01b,0x01b,0x01b,0x18e,0x060,0x018,0x1c6,0x360,0x360,0x360,0x1c0,0x000,0x000,0x000,0x000,0x000 },	// %
+    { 0x000,0x000,0x000,0x078,0x00c,0x00c,0x00c,0x018,0x01c,0x1bc,0x1b6,0x1f6,0x0e6,0x06c,0x0d8,0x000,0x000,0x000,0x000,0x000 },	// &
+    { 0x000,0x000,0x000,0x010,0x010,0x010,0x010,0x010,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000 },	// '
+    { 0x000,0x000,0x0c0,0x040,0x060,0x060,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x060,0x060,0x040,0x0c0,0x000,0x000,0x000 },	// (
+    { 0x000,0x000,0x018,0x010,0x030,0x030,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x030,0x030,0x010,0x018,0x000,0x000,0x000 },	// )
+    { 0x000,0x000,0x000,0x020,0x020,0x124,0x0f8,0x070,0x1ac,0x020,0x020,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000 },	// *
+    { 0x000,0x000,0x000,0x000,0x030,0x030,0x030,0x030,0x3ff,0x3ff,0x030,0x030,0x030,0x030,0x000,0x000,0x000,0x000,0x000,0x000 },	// +
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x030,0x030,0x030,0x018,0x008,0x000,0x000,0x000 },	// ,
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x078,0x078,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000 },	// -
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x030,0x030,0x030,0x000,0x000,0x000,0x000,0x000 },	// .
+    { 0x000,0x000,0x000,0x300,0x180,0x180,0x0c0,0x0c0,0x060,0x060,0x030,0x030,0x018,0x018,0x00c,0x00c,0x006,0x000,0x000,0x000 },	// /
+    { 0x000,0x000,0x000,0x078,0x0cc,0x084,0x186,0x186,0x1b6,0x1b6,0x186,0x186,0x084,0x0cc,0x078,0x000,0x000,0x000,0x000,0x000 },	// 0
+    { 0x000,0x000,0x000,0x070,0x06c,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x3fc,0x000,0x000,0x000,0x000,0x000 },	// 1
+    { 0x000,0x000,0x000,0x07c,0x0c6,0x182,0x180,0x180,0x1c0,0x0e0,0x070,0x038,0x01c,0x00e,0x1fe,0x000,0x000,0x000,0x000,0x000 },	// 2
+    { 0x000,0x000,0x000,0x07c,0x0c2,0x180,0x180,0x0c0,0x038,0x0c0,0x180,0x180,0x180,0x0c2,0x07c,0x000,0x000,0x000,0x000,0x000 },	// 3
+    { 0x000,0x000,0x000,0x0c0,0x0e0,0x0f0,0x0d0,0x0c8,0x0cc,0x0c4,0x0c2,0x3fe,0x0c0,0x0c0,0x0c0,0x000,0x000,0x000,0x000,0x000 },	// 4
+    { 0x000,0x000,0x000,0x0fc,0x00c,0x00c,0x00c,0x07c,0x0c4,0x180,0x180,0x180,0x180,0x0c2,0x07c,0x000,0x000,0x000,0x000,0x000 },	// 5
+    { 0x000,0x000,0x000,0x078,0x08c,0x00c,0x006,0x076,0x0ce,0x186,0x186,0x186,0x186,0x0cc,0x078,0x000,0x000,0x000,0x000,0x000 },	// 6
+    { 0x000,0x000,0x000,0x1fe,0x180,0x0c0,0x0c0,0x0c0,0x060,0x060,0x060,0x030,0x030,0x030,0x018,0x000,0x000,0x000,0x000,0x000 },	// 7
+    { 0x000,0x000,0x000,0x078,0x1ce,0x186,0x186,0x0cc,0x078,0x0cc,0x186,0x186,0x186,0x0cc,0x078,0x000,0x000,0x000,0x000,0x000 },	// 8
+    { 0x000,0x000,0x000,0x078,0x0cc,0x186,0x186,0x186,0x186,0x1cc,0x1b8,0x180,0x0c0,0x0c4,0x078,0x000,0x000,0x000,0x000,0x000 },	// 9
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x030,0x030,0x030,0x000,0x000,0x000,0x030,0x030,0x030,0x000,0x000,0x000,0x000,0x000 },	// :
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x030,0x030,0x030,0x000,0x000,0x000,0x030,0x030,0x030,0x018,0x008,0x000,0x000,0x000 },	// ;
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x200,0x3c0,0x078,0x00e,0x00e,0x078,0x3c0,0x200,0x000,0x000,0x000,0x000,0x000,0x000 },	// <
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x3fe,0x3fe,0x000,0x000,0x3fe,0x3fe,0x000,0x000,0x000,0x000,0x000,0x000,0x000 },	// =
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x002,0x01e,0x0f0,0x380,0x380,0x0f0,0x01e,0x002,0x000,0x000,0x000,0x000,0x000,0x000 },	// >
+    { 0x000,0x000,0x000,0x0f8,0x184,0x180,0x1c0,0x0e0,0x070,0x030,0x030,0x030,0x000,0x030,0x030,0x000,0x000,0x000,0x000,0x000 },	// ?
+    { 0x000,0x000,0x000,0x0f0,0x1c8,0x18c,0x1e4,0x1e6,0x1b6,0x1b6,0x1b6,0x1b6,0x1b6,0x1e6,0x1ec,0x00c,0x018,0x070,0x000,0x000 },	// @
+    { 0x000,0x000,0x000,0x030,0x030,0x078,0x078,0x078,0x048,0x0cc,0x0cc,0x0fc,0x0cc,0x186,0x186,0x000,0x000,0x000,0x000,0x000 },	// A
+    { 0x000,0x000,0x000,0x07e,0x186,0x186,0x186,0x1c6,0x07e,0x0c6,0x186,0x186,0x186,0x1c6,0x07e,0x000,0x000,0x000,0x000,0x000 },	// B
+    { 0x000,0x000,0x000,0x0f0,0x11c,0x00c,0x006,0x006,0x006,0x006,0x006,0x006,0x00c,0x11c,0x0f0,0x000,0x000,0x000,0x000,0x000 },	// C
+    { 0x000,0x000,0x000,0x03e,0x0c6,0x086,0x186,0x186,0x186,0x186,0x186,0x186,0x0c6,0x0c6,0x03e,0x000,0x000,0x000,0x000,0x000 },	// D
+    { 0x000,0x000,0x000,0x1fe,0x006,0x006,0x006,0x006,0x1fe,0x006,0x006,0x006,0x006,0x006,0x1fe,0x000,0x000,0x000,0x000,0x000 },	// E
+    { 0x000,0x000,0x000,0x1fe,0x006,0x006,0x006,0x006,0x0fe,0x006,0x006,0x006,0x006,0x006,0x006,0x000,0x000,0x000,0x000,0x000 },	// F
+    { 0x000,0x000,0x000,0x0f0,0x10c,0x00c,0x006,0x006,0x006,0x1e6,0x186,0x186,0x18c,0x18c,0x0f0,0x000,0x000,0x000,0x000,0x000 },	// G
+    { 0x000,0x000,0x000,0x186,0x186,0x186,0x186,0x186,0x1fe,0x186,0x186,0x186,0x186,0x186,0x186,0x000,0x000,0x000,0x000,0x000 },	// H
+    { 0x000,0x000,0x000,0x1fe,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x1fe,0x000,0x000,0x000,0x000,0x000 },	// I
+    { 0x000,0x000,0x000,0x0f8,0x0c0,0x0c0,0x0c0,0x0c0,0x0c0,0x0c0,0x0c0,0x0c0,0x0c0,0x062,0x07c,0x000,0x000,0x000,0x000,0x000 },	// J
+    { 0x000,0x000,0x000,0x306,0x186,0x0c6,0x066,0x036,0x03e,0x03e,0x066,0x0e6,0x1c6,0x186,0x306,0x000,0x000,0x000,0x000,0x000 },	// K
+    { 0x000,0x000,0x000,0x006,0x006,0x006,0x006,0x006,0x006,0x006,0x006,0x006,0x006,0x006,0x1fe,0x000,0x000,0x000,0x000,0x000 },	// L
+    { 0x000,0x000,0x000,0x1ce,0x1ce,0x1ce,0x1ce,0x1b6,0x1b6,0x1b6,0x1b6,0x186,0x186,0x186,0x186,0x000,0x000,0x000,0x000,0x000 },	// M
+    { 0x000,0x000,0x000,0x18e,0x18e,0x18e,0x19e,0x196,0x196,0x1a6,0x1a6,0x1e6,0x1c6,0x1c6,0x1c6,0x000,0x000,0x000,0x000,0x000 },	// N
+    { 0x000,0x000,0x000,0x078,0x0cc,0x186,0x186,0x186,0x186,0x186,0x186,0x186,0x186,0x0cc,0x078,0x000,0x000,0x000,0x000,0x000 },	// O
+    { 0x000,0x000,0x000,0x07e,0x0c6,0x186,0x186,0x186,0x0c6,0x07e,0x006,0x006,0x006,0x006,0x006,0x000,0x000,0x000,0x000,0x000 },	// P
+    { 0x000,0x000,0x000,0x078,0x0cc,0x086,0x186,0x186,0x186,0x186,0x186,0x186,0x086,0x0cc,0x078,0x040,0x0c0,0x000,0x000,0x000 },	// Q
+    { 0x000,0x000,0x000,0x07e,0x0c6,0x186,0x186,0x186,0x0c6,0x07e,0x0c6,0x0c6,0x186,0x186,0x306,0x000,0x000,0x000,0x000,0x000 },	// R
+    { 0x000,0x000,0x000,0x078,0x08c,0x006,0x006,0x01e,0x0fc,0x1e0,0x180,0x180,0x180,0x1c6,0x07c,0x000,0x000,0x000,0x000,0x000 },	// S
+    { 0x000,0x000,0x000,0x3ff,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x000,0x000,0x000,0x000,0x000 },	// T
+    { 0x000,0x000,0x000,0x186,0x186,0x186,0x186,0x186,0x186,0x186,0x186,0x186,0x186,0x0cc,0x078,0x000,0x000,0x000,0x000,0x000 },	// U
+    { 0x000,0x000,0x000,0x186,0x186,0x0cc,0x0cc,0x0cc,0x0cc,0x078,0x078,0x078,0x078,0x030,0x030,0x000,0x000,0x000,0x000,0x000 },	// V
+    { 0x000,0x000,0x000,0x303,0x303,0x303,0x1b6,0x1b6,0x1b6,0x1fe,0x1ce,0x1ce,0x1ce,0x0cc,0x084,0x000,0x000,0x000,0x000,0x000 },	// W
+    { 0x000,0x000,0x000,0x1ce,0x0cc,0x0fc,0x078,0x030,0x030,0x030,0x078,0x078,0x0ec,0x0cc,0x1c6,0x000,0x000,0x000,0x000,0x000 },	// X
+    { 0x000,0x000,0x000,0x387,0x186,0x0cc,0x0cc,0x078,0x078,0x030,0x030,0x030,0x030,0x030,0x030,0x000,0x000,0x000,0x000,0x000 },	// Y
+    { 0x000,0x000,0x000,0x1fe,0x180,0x0c0,0x0e0,0x060,0x030,0x030,0x018,0x01c,0x00c,0x006,0x1fe,0x000,0x000,0x000,0x000,0x000 },	// Z
+    { 0x000,0x000,0x0f0,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x0f0,0x000,0x000,0x000 },	// [
+    { 0x000,0x000,0x000,0x006,0x00c,0x00c,0x018,0x018,0x030,0x030,0x060,0x060,0x0c0,0x0c0,0x180,0x180,0x300,0x000,0x000,0x000 },	// backslash
+    { 0x000,0x000,0x078,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x078,0x000,0x000,0x000 },	// ]
+    { 0x000,0x000,0x000,0x070,0x050,0x0d8,0x18c,0x306,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000 },	// ^
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x3ff,0x000 },	// _
+    { 0x000,0x00c,0x018,0x030,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000 },	// `
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x0f8,0x184,0x180,0x1f8,0x18e,0x186,0x186,0x1c6,0x1bc,0x000,0x000,0x000,0x000,0x000 },	// a
+    { 0x000,0x000,0x006,0x006,0x006,0x006,0x076,0x0ce,0x186,0x186,0x186,0x186,0x186,0x0ce,0x076,0x000,0x000,0x000,0x000,0x000 },	// b
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x078,0x08c,0x006,0x006,0x006,0x006,0x006,0x08c,0x078,0x000,0x000,0x000,0x000,0x000 },	// c
+    { 0x000,0x000,0x180,0x180,0x180,0x180,0x1b8,0x1cc,0x186,0x186,0x186,0x186,0x186,0x1cc,0x1b8,0x000,0x000,0x000,0x000,0x000 },	// d
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x078,0x0cc,0x186,0x186,0x1fe,0x006,0x006,0x10c,0x0f8,0x000,0x000,0x000,0x000,0x000 },	// e
+    { 0x000,0x000,0x1e0,0x030,0x030,0x030,0x1fc,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x000,0x000,0x000,0x000,0x000 },	// f
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x1b8,0x1cc,0x186,0x186,0x186,0x186,0x186,0x1cc,0x1b8,0x180,0x180,0x0c4,0x078,0x000 },	// g
+    { 0x000,0x000,0x006,0x006,0x006,0x006,0x0f6,0x1ce,0x186,0x186,0x186,0x186,0x186,0x186,0x186,0x000,0x000,0x000,0x000,0x000 },	// h
+    { 0x000,0x000,0x060,0x060,0x000,0x000,0x078,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x3fc,0x000,0x000,0x000,0x000,0x000 },	// i
+    { 0x000,0x000,0x060,0x060,0x000,0x000,0x07c,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x060,0x03c,0x000 },	// j
+    { 0x000,0x000,0x006,0x006,0x006,0x006,0x1c6,0x0e6,0x076,0x03e,0x03e,0x07e,0x066,0x0e6,0x1c6,0x000,0x000,0x000,0x000,0x000 },	// k
+    { 0x000,0x000,0x03e,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x1e0,0x000,0x000,0x000,0x000,0x000 },	// l
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x0de,0x1b6,0x1b6,0x1b6,0x1b6,0x1b6,0x1b6,0x1b6,0x1b6,0x000,0x000,0x000,0x000,0x000 },	// m
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x0f6,0x1ce,0x186,0x186,0x186,0x186,0x186,0x186,0x186,0x000,0x000,0x000,0x000,0x000 },	// n
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x078,0x0cc,0x186,0x186,0x186,0x186,0x186,0x0cc,0x078,0x000,0x000,0x000,0x000,0x000 },	// o
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x076,0x0ce,0x186,0x186,0x186,0x186,0x186,0x0ce,0x076,0x006,0x006,0x006,0x006,0x000 },	// p
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x1b8,0x1cc,0x186,0x186,0x186,0x186,0x186,0x1cc,0x1b8,0x180,0x180,0x180,0x180,0x000 },	// q
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x1d8,0x238,0x038,0x018,0x018,0x018,0x018,0x018,0x018,0x000,0x000,0x000,0x000,0x000 },	// r
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x0f8,0x106,0x006,0x07e,0x1fc,0x1c0,0x180,0x182,0x07c,0x000,0x000,0x000,0x000,0x000 },	// s
+    { 0x000,0x000,0x000,0x030,0x030,0x030,0x1fc,0x030,0x030,0x030,0x030,0x030,0x030,0x030,0x1e0,0x000,0x000,0x000,0x000,0x000 },	// t
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x186,0x186,0x186,0x186,0x186,0x186,0x186,0x1ce,0x1bc,0x000,0x000,0x000,0x000,0x000 },	// u
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x186,0x0cc,0x0cc,0x0cc,0x078,0x078,0x078,0x030,0x030,0x000,0x000,0x000,0x000,0x000 },	// v
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x303,0x303,0x186,0x1b6,0x1b6,0x1b6,0x0cc,0x0cc,0x0cc,0x000,0x000,0x000,0x000,0x000 },	// w
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x1ce,0x0fc,0x078,0x030,0x030,0x078,0x078,0x0cc,0x1ce,0x000,0x000,0x000,0x000,0x000 },	// x
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x186,0x1cc,0x0cc,0x0cc,0x0f8,0x078,0x078,0x070,0x030,0x030,0x038,0x018,0x00c,0x000 },	// y
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x1fe,0x1c0,0x0e0,0x070,0x030,0x018,0x01c,0x00e,0x1fe,0x000,0x000,0x000,0x000,0x000 },	// z
+    { 0x000,0x000,0x0e0,0x030,0x030,0x030,0x030,0x030,0x030,0x00e,0x038,0x030,0x030,0x030,0x030,0x030,0x030,0x0e0,0x000,0x000 },	// {
+    { 0x000,0x000,0x010,0x010,0x010,0x010,0x010,0x010,0x010,0x010,0x010,0x010,0x010,0x010,0x010,0x010,0x010,0x010,0x010,0x000 },	// |
+    { 0x000,0x000,0x01c,0x030,0x030,0x030,0x030,0x030,0x030,0x1c0,0x070,0x030,0x030,0x030,0x030,0x030,0x030,0x01c,0x000,0x000 },	// }
+    { 0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x23c,0x3fe,0x1c2,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000,0x000 },	// ~
+};
+//}}}
@@ -0,0 +1,112 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "xdlg.h"
+#include "assuan.h"
+#include <sys/stat.h>
+#include <fcntl.h>
+
+//----------------------------------------------------------------------
+// Headless dialog backend
+//
+// Plays keystrokes from a script instead of showing a window, so the
+// protocol and entry logic can be run without a display. The script is
+// taken from $PINENTRY_XLIB_SCRIPT, or read from the file named by
+// $PINENTRY_XLIB_SCRIPT_FILE. Each line is typed into one dialog, and
+// the script starts over when all lines are used. Printable characters
+// are typed as is; \r is Return, \e is Escape, \b is BackSpace, and a
+// doubled backslash types one. A line that ends before the dialog is
+// answered acts as a timeout, so "secret\r" enters a password, "\e"
+// cancels.
+
+static char* _script = NULL;
+static size_t _scriptLen = 0;
+static size_t _scriptPos = 0;
+
+static bool HeadlessOpen (void);
+static bool HeadlessRunDialog (void);
+static void HeadlessClose (void);
+static const char* HeadlessRenderPath (void);
+static char* LoadScriptFile (const char* filename, size_t* len);
+
+const dlgbackend_t c_HeadlessBackend = { "headless", HeadlessOpen, HeadlessRunDialog, HeadlessClose, HeadlessRenderPath, NULL, NULL };
+
+//----------------------------------------------------------------------
+
+static bool HeadlessOpen (void)
+{
+    if (_script)
+	return true;
+    const char* filename = getenv ("PINENTRY_XLIB_SCRIPT_FILE");
+    if (filename)
+	_script = LoadScriptFile (filename, &_scriptLen);
+    else {
+	const char* text = getenv ("PINENTRY_XLIB_SCRIPT");
+	if (text && (_script = strdup (text)))
+	    _scriptLen = strlen (text);
+    }
+    if (!_script) {
+	ReplyLine ("ERR Unable to load the dialog script");
+	_dialogFailed = true;
+    }
+    return _script;
+}
+
+static char* LoadScriptFile (const char* filename, size_t* len)
+{
+    int fd = open (filename, O_RDONLY| O_CLOEXEC);
+    if (fd < 0)
+	return NULL;
+    struct stat st;
+    char* s = NULL;
+    if (0 == fstat (fd, &st) && (s = malloc (st.st_size+1))) {
+	size_t n = 0;
+	for (ssize_t br; n < (size_t) st.st_size; n += br)
+	    if (0 >= (br = read (fd, &s[n], st.st_size-n)))
+		break;
+	s[*len = n] = 0;
+    }
+    close (fd);
+    return s;
+}
+
+static bool HeadlessRunDialog (void)
+{
+    if (_scriptPos >= _scriptLen)
+	_scriptPos = 0;
+    while (_scriptPos < _scriptLen) {
+	unsigned k = (unsigned char) _script[_scriptPos++];
+	if (k == '\n')
+	    break;	// Out of keys for this dialog
+	if (k == '\\' && _scriptPos < _scriptLen) {
+	    k = (unsigned char) _script[_scriptPos++];
+	    if (k == 'r')	k = key_Return;
+	    else if (k == 'e')	k = key_Escape;
+	    else if (k == 'b')	k = key_BackSpace;
+	}
+	if (OnKey (k)) {
+	    // Skip the rest of the line, so the next dialog starts on the next
+	    const char* eol = memchr (&_script[_scriptPos], '\n', _scriptLen-_scriptPos);
+	    _scriptPos = eol ? (size_t)(eol - _script) + 1 : _scriptLen;
+	    break;
+	}
+    }
+    return _accepted;
+}
+
+static void HeadlessClose (void)
+{
+    if (_script) {
+	memset (_script, 0, _scriptLen);	// May contain passwords
+	free (_script);
+    }
+    _script = NULL;
+    _scriptLen = _scriptPos = 0;
+}
+
+static const char* HeadlessRenderPath (void)
+{
+    return "headless";
+}
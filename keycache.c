@@ -0,0 +1,101 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "keycache.h"
+#if __has_include(<linux/keyctl.h>)
+    #include <linux/keyctl.h>
+    #include <sys/syscall.h>
+#endif
+
+//----------------------------------------------------------------------
+
+enum { KEY_DESC_MAXLEN = 128 };
+
+static keycachestats_t _cacheStats = {0,0,0,0};
+
+#if __has_include(<linux/keyctl.h>)
+
+static bool KeyDescription (const char* keyinfo, char* desc);
+static long FindKey (const char* keyinfo);
+
+//----------------------------------------------------------------------
+// glibc has no wrappers for the keyring calls; libkeyutils is not needed for these few
+
+static bool KeyDescription (const char* keyinfo, char* desc)
+{
+    const int r = snprintf (desc, KEY_DESC_MAXLEN, PINENTRY_NAME ":%s", keyinfo);
+    return keyinfo[0] && r > 0 && r < KEY_DESC_MAXLEN;
+}
+
+static long FindKey (const char* keyinfo)
+{
+    // Expired and revoked keys are not found
+    char desc [KEY_DESC_MAXLEN];
+    if (!KeyDescription (keyinfo, desc))
+	return -1;
+    return syscall (__NR_keyctl, KEYCTL_SEARCH, KEY_SPEC_SESSION_KEYRING, "user", desc, 0);
+}
+
+bool KeycacheLookup (const char* keyinfo, char* pw, size_t pwsz, size_t* len)
+{
+    long id = FindKey (keyinfo), n = -1;
+    if (id >= 0)
+	n = syscall (__NR_keyctl, KEYCTL_READ, id, pw, pwsz);
+    if (n < 0 || (size_t) n >= pwsz) {	// Too long for the buffer, so read only in part
+	memset (pw, 0, pwsz);
+	++_cacheStats.misses;
+	return false;
+    }
+    pw[*len = n] = 0;
+    ++_cacheStats.hits;
+    return true;
+}
+
+void KeycacheStore (const char* keyinfo, const char* pw, size_t len, unsigned ttl)
+{
+    char desc [KEY_DESC_MAXLEN];
+    if (!ttl || !KeyDescription (keyinfo, desc))
+	return;
+    // Replaces the payload of an existing key with the same description
+    long id = syscall (__NR_add_key, "user", desc, pw, len, KEY_SPEC_SESSION_KEYRING);
+    if (id < 0)
+	return;
+    // A key that would never expire is not left behind
+    if (0 > syscall (__NR_keyctl, KEYCTL_SET_TIMEOUT, id, ttl)) {
+	syscall (__NR_keyctl, KEYCTL_REVOKE, id);
+	syscall (__NR_keyctl, KEYCTL_UNLINK, id, KEY_SPEC_SESSION_KEYRING);
+	return;
+    }
+    ++_cacheStats.stores;
+}
+
+void KeycacheClear (const char* keyinfo)
+{
+    long id = FindKey (keyinfo);
+    if (id < 0)
+	return;
+    // Revoking stops all readers at once; unlinking lets a new passphrase be stored
+    syscall (__NR_keyctl, KEYCTL_REVOKE, id);
+    syscall (__NR_keyctl, KEYCTL_UNLINK, id, KEY_SPEC_SESSION_KEYRING);
+    ++_cacheStats.clears;
+}
+
+#else	// No kernel keyring; every lookup misses
+
+bool KeycacheLookup (const char* keyinfo UNUSED, char* pw UNUSED, size_t pwsz UNUSED, size_t* len UNUSED)
+{
+    ++_cacheStats.misses;
+    return false;
+}
+
+void KeycacheStore (const char* keyinfo UNUSED, const char* pw UNUSED, size_t len UNUSED, unsigned ttl UNUSED) {}
+void KeycacheClear (const char* keyinfo UNUSED) {}
+
+#endif
+
+keycachestats_t KeycacheStats (void)
+{
+    return _cacheStats;
+}
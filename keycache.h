@@ -0,0 +1,25 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "config.h"
+#include <stdbool.h>
+
+//----------------------------------------------------------------------
+// Passphrases cached in the kernel session keyring, as user keys named
+// by the SETKEYINFO string. The kernel expires them after their TTL.
+
+typedef struct {
+    unsigned	hits;
+    unsigned	misses;
+    unsigned	stores;
+    unsigned	clears;
+} keycachestats_t;
+
+// Reads the passphrase for keyinfo into pw, setting *len
+bool KeycacheLookup (const char* keyinfo, char* pw, size_t pwsz, size_t* len);
+void KeycacheStore (const char* keyinfo, const char* pw, size_t len, unsigned ttl);
+void KeycacheClear (const char* keyinfo);
+keycachestats_t KeycacheStats (void);
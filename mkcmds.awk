@@ -0,0 +1,76 @@
+# This file is part of the pinentry-xlib project
+#
+# Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+# This file is free software, distributed under the MIT License.
+#
+# Builds cmds.h, the command dispatch table, from cmds.txt.
+#
+# The hash of a command is computed from its length and its first, next
+# to last, and last characters, lowercased with |0x20:
+#   (len + a*last + b*prev + first) % nslots
+# The smallest power of two nslots and the first multipliers that make
+# the hashes of all commands distinct are searched for here. The output
+# is a list of CMD(name,slot) lines, for including with CMD defined.
+
+BEGIN {
+    ncmds = 0; minlen = 255; maxlen = 0
+    for (i = 32; i < 127; ++i)
+	ord[sprintf ("%c", i)] = i
+}
+
+/^#/ || NF == 0 { next }
+
+{
+    name = $1
+    if (name !~ /^[A-Z_]+$/ || length(name) < 2 || name in seen) {
+	printf ("cmds.txt: invalid or repeated command %s\n", name) > "/dev/stderr"
+	exit 1
+    }
+    seen[name] = 1
+    cmd[ncmds++] = name
+    n = length(name)
+    if (n < minlen) minlen = n
+    if (n > maxlen) maxlen = n
+}
+
+function lc(c,	v) {
+    v = ord[c]
+    return int(v/32)%2 ? v : v+32
+}
+
+function hash(name, a, b, nslots,	n) {
+    n = length(name)
+    return (n + a*lc(substr(name, n, 1)) + b*lc(substr(name, n-1, 1)) + lc(substr(name, 1, 1))) % nslots
+}
+
+# Returns true if a and b hash all commands to different slots
+function isperfect(a, b, nslots,	i, h, used) {
+    for (i = 0; i < ncmds; ++i) {
+	h = hash(cmd[i], a, b, nslots)
+	if (h in used)
+	    return 0
+	used[h] = 1
+    }
+    return 1
+}
+
+END {
+    if (!ncmds)
+	exit 1
+    for (nslots = 2; nslots < ncmds; nslots *= 2) {}
+    for (found = 0; !found && nslots <= 256; nslots *= 2)
+	for (a = 1; !found && a < nslots; ++a)
+	    for (b = 1; !found && b < nslots; ++b)
+		found = isperfect(a, b, nslots)
+    if (!found) {
+	print "mkcmds.awk: no perfect hash for cmds.txt" > "/dev/stderr"
+	exit 1
+    }
+    nslots /= 2; --a; --b
+    printf ("// Generated by mkcmds.awk from cmds.txt; do not edit.\n")
+    printf ("// %d commands hashed into %d slots.\n", ncmds, nslots)
+    printf ("#define CMD_HASH(first,prev,last,len)\t(((len) + %d*((last)|0x20) + %d*((prev)|0x20) + ((first)|0x20)) %% %d)\n", a, b, nslots)
+    printf ("#define CMD_NSLOTS\t%d\n#define CMD_MINLEN\t%d\n#define CMD_MAXLEN\t%d\n", nslots, minlen, maxlen)
+    for (i = 0; i < ncmds; ++i)
+	printf ("CMD(%s,%d)\n", cmd[i], hash(cmd[i], a, b, nslots))
+}
@@ -0,0 +1,75 @@
+# This file is part of the pinentry-xlib project
+#
+# Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+# This file is free software, distributed under the MIT License.
+#
+# Builds dict.h, the word trie of the quality estimator, from dict.txt.
+#
+# Words are inserted last letter first, so the estimator can find every
+# word ending at the newest character by walking back from it. Each node
+# is a run of edges sorted by letter, stored breadth first. An edge is
+# { letter, with 0x80 set on the last in the run; log2(rank)*16 if the
+# path to here spells a word, or 255; index of the child's first edge,
+# or 0 if there is none }.
+
+BEGIN { nnodes = 1; nwords = 0; letters = "abcdefghijklmnopqrstuvwxyz" }
+
+/^#/ { next }
+
+{
+    for (w = 1; w <= NF; ++w) {
+	word = $w
+	if (length(word) < 3 || word !~ /^[a-z]+$/ || word in seen)
+	    continue
+	seen[word] = 1
+	node = 0
+	for (i = length(word); i > 0; --i) {
+	    c = substr(word, i, 1)
+	    if (!((node, c) in child))
+		child[node, c] = nnodes++
+	    node = child[node, c]
+	}
+	bits[node] = int(log(++nwords)/log(2)*16 + 0.5)
+    }
+}
+
+END {
+    # First pass assigns edge runs to nodes in breadth first order
+    queue[0] = 0; qn = 1; nedges = 0
+    for (q = 0; q < qn; ++q) {
+	node = queue[q]
+	for (i = 1; i <= 26; ++i) {
+	    c = substr(letters, i, 1)
+	    if ((node, c) in child) {
+		if (!(node in first))
+		    first[node] = nedges
+		++nedges
+		queue[qn++] = child[node, c]
+	    }
+	}
+    }
+    if (nedges > 65535) {
+	print "dict.txt has too many words" > "/dev/stderr"
+	exit 1
+    }
+    printf ("// Generated by mkdict.awk from dict.txt; do not edit.\n")
+    printf ("// %d words in %d edges.\n", nwords, nedges)
+    for (q = 0; q < qn; ++q) {
+	node = queue[q]
+	if (!(node in first))
+	    continue
+	line = ""
+	for (i = 1; i <= 26; ++i) {
+	    c = substr(letters, i, 1)
+	    if (!((node, c) in child))
+		continue
+	    k = child[node, c]
+	    last = 128
+	    for (j = i+1; j <= 26; ++j)
+		if ((node, substr(letters, j, 1)) in child)
+		    last = 0
+	    line = line sprintf ("{%d,%d,%d},", 96+i+last, (k in bits) ? bits[k] : 255, (k in first) ? first[k] : 0)
+	}
+	print line
+    }
+}
@@ -4,13 +4,43 @@
 // This file is free software, distributed under the MIT License.
 
 #include "xdlg.h"
+#include "daemon.h"
+#include "assuan.h"
+#include "trace.h"
+#include "stats.h"
+#include "secmem.h"
+#include "keycache.h"
+#include "command.h"
+#include "codec.h"
 #include <getopt.h>
 #include <signal.h>
-#include <ctype.h>
 
 //----------------------------------------------------------------------
 
 static bool _askpassMode = false;	// If using the ssh-askpass interface
+static bool _daemonMode = false;	// If serving sessions over the daemon socket
+static bool _noForward = false;		// If running sessions here even when a daemon is running
+static bool _prewarmMode = false;	// If opening the display while the handshake runs
+static bool _inDialog = false;		// Dialog commands are not allowed while a dialog is open
+static bool _byePending = false;	// BYE arrived while a dialog was open
+static bool _inPreamble = false;	// Reading the settings forwarded by the client
+
+// Passphrases are cached in the kernel keyring for _cacheTtl seconds,
+// if the agent allows it, under the key named by SETKEYINFO. The agent
+// can not set the ttl; only --cache-ttl can, here or forwarded.
+static unsigned _cacheTtl = 0;
+static bool _cacheAllowed = false;
+static char _keyinfo [64] = "";
+
+// Command line settings, restored at the start of each daemon session
+static struct {
+    const char*	displayName;
+    unsigned	parentWindow;
+    unsigned	entryTimeout;
+    bool	nograb;
+    bool	noServerGrab;
+    unsigned	cacheTtl;
+} _defaults;
 
 //----------------------------------------------------------------------
 
@@ -18,28 +48,51 @@ static void OnSignal (int sig);
 static void InstallCleanupHandler (void);
 static void ParseCommandLine (int argc, char* argv[]);
 static void PrintHelp (void);
+static bool ForwardSession (void);
+static void RestoreDefaults (void);
+static void ClearMultiDescriptions (void);
+static bool IsCacheUsable (void);
+static bool ParseSeconds (const char* s, unsigned* secs);
+static bool IsCommentLine (const char* line);
 static void RunAssuanProtocol (void);
-static void PercentEscape (char* s, size_t smaxlen);
-static void PercentUnescape (char* s, size_t smaxlen);
+static bool ChangesLayout (enum ECmd cmd);
+static bool RunDialog (edlgtype_t dlgtype);
+static enum ECmd ProcessCommand (char* line);
 static void UnderscoreUnescape (char* s, size_t smaxlen);
 
 //----------------------------------------------------------------------
 
 int main (int argc, char* argv[])
 {
+    TracePhase (phase_Exec);
+    if (!SecmemInit()) {
+	fputs ("Error: unable to allocate secure memory\n", stderr);
+	return EXIT_FAILURE;
+    }
     InstallCleanupHandler();
+    StatsDumpAtExit();
     ParseCommandLine (argc, argv);
-    if (!_askpassMode)
+    if (_daemonMode) {
+	if (!RunDaemon (RunAssuanProtocol)) {
+	    fputs ("Error: unable to listen on the daemon socket\n", stderr);
+	    return EXIT_FAILURE;
+	}
+    } else if (_askpassMode) {
+	if (RunMainDialog()) {
+	    ReplyLine (_password);
+	    FlushReplies();
+	}
+    } else if (_noForward || !ForwardSession())
 	RunAssuanProtocol();
-    else if (RunMainDialog())
-	puts (_password);
     return EXIT_SUCCESS;
 }
 
 static void OnSignal (int sig)
 {
-    printf ("ERR %s\n", strsignal(sig));
-    fflush (stdout);
+    DiscardReplies();	// May contain a passphrase
+    ReplyF ("ERR %s\n", strsignal(sig));
+    FlushReplies();
+    SecmemWipe();
     abort();
 }
 
@@ -62,6 +115,11 @@ static void ParseCommandLine (int argc, char* argv[])
 	{ "parent-wid",		required_argument,	0, 'w' },
 	{ "timeout",		required_argument,	0, 't' },
 	{ "display",		required_argument,	0, 'd' },
+	{ "daemon",		no_argument,		0, 'D' },
+	{ "prewarm",		no_argument,		0, 'P' },
+	{ "no-forward",		no_argument,		0, 'N' },
+	{ "no-server-grab",	no_argument,		0, 'G' },
+	{ "cache-ttl",		required_argument,	0, 'C' },
 	{ "ttyname",		required_argument,	0, 0 },
 	{ "ttytype",		required_argument,	0, 0 },
 	{ "lc-ctype",		required_argument,	0, 0 },
@@ -82,15 +140,32 @@ static void ParseCommandLine (int argc, char* argv[])
 	else if (c == 't')
 	    _entryTimeout = atoi (optarg);
 	else if (c == 'd')
-	    _displayName = strdup (optarg);
+	    _displayName = optarg;
+	else if (c == 'D')
+	    _daemonMode = true;
+	else if (c == 'P')
+	    _prewarmMode = true;
+	else if (c == 'N')
+	    _noForward = true;
+	else if (c == 'G')
+	    _noServerGrab = true;
+	else if (c == 'C' && !ParseSeconds (optarg, &_cacheTtl)) {
+	    fprintf (stderr, "Invalid --cache-ttl value: %s\n", optarg);
+	    exit (EXIT_FAILURE);
+	}
     }
     if (optind+1 == argc) {
-	_description = strdup (argv[optind]);
+	_description = argv[optind];
 	_askpassMode = true;
-    } else
-	_description = strdup (DEFAULT_DESCRIPTION);
+    }
     _argc = argc;
     _argv = (const char* const*) argv;
+    _defaults.displayName = _displayName;
+    _defaults.parentWindow = _parentWindow;
+    _defaults.entryTimeout = _entryTimeout;
+    _defaults.nograb = _nograb;
+    _defaults.noServerGrab = _noServerGrab;
+    _defaults.cacheTtl = _cacheTtl;
 }
 
 static void PrintHelp (void)
@@ -105,234 +180,453 @@ static void PrintHelp (void)
 	"      --lc-messages     Set the tty LC_MESSAGES value\n"
 	"      --timeout SECS    Timeout waiting for input after this many seconds\n"
 	"  -g, --no-global-grab  Grab keyboard only while window is focused\n"
+	"      --no-server-grab  Grab the X server only while grabbing the keyboard\n"
+	"      --cache-ttl SECS  Cache passphrases in the kernel keyring if allowed\n"
 	"      --parent-wid      Parent window ID (for positioning)\n"
+	"      --daemon          Keep running, serving sessions from a socket\n"
+	"      --prewarm         Connect to X while the agent sends options\n"
+	"      --no-forward      Do not pass the session to a running daemon\n"
 	"  -d, --debug           Turn on debugging output\n"
 	"  -h, --help            Display this help and exit\n"
 	"      --version         Output version information and exit");
 }
 
-enum ECmd {
-    cmd_BYE,
-    cmd_CONFIRM,
-    cmd_GETINFO,
-    cmd_GETPIN,
-    cmd_MESSAGE,
-    cmd_OPTION,
-    cmd_SETDESC,
-    cmd_SETPROMPT,
-    cmd_SETQUALITYBAR,
-    cmd_SETTIMEOUT,
-    cmd_SETTITLE,
-    cmd_SETCANCEL,
-    cmd_SETERROR,
-    cmd_SETNOTOK,
-    cmd_SETOK,
-    cmd_SETQUALITYBAR_TT,
-    cmd_SETKEYINFO,
-    cmd_SETREPEAT,
-    cmd_SETREPEATERROR,
-    cmd_CLEARPASSPHRASE,
-    cmd_NCMDS
-};
+static bool ForwardSession (void)
+{
+    // Pass command line settings on to the daemon, since its own are
+    // the ones it was started with. Returns false if there is no daemon.
+    char preamble [4*ASSUAN_LINE_LIMIT] = "", *p = preamble, *pend = &preamble[sizeof(preamble)];
+    if (_displayName)
+	p += snprintf (p, pend-p, "OPTION display=%.*s\n", ASSUAN_LINE_LIMIT/2, _displayName);
+    if (_parentWindow)
+	p += snprintf (p, pend-p, "OPTION parent-wid=%u\n", _parentWindow);
+    if (_entryTimeout)
+	p += snprintf (p, pend-p, "SETTIMEOUT %u\n", _entryTimeout);
+    if (_nograb)
+	p += snprintf (p, pend-p, "OPTION no-grab\n");
+    if (_noServerGrab)
+	p += snprintf (p, pend-p, "OPTION no-server-grab\n");
+    if (_cacheTtl)
+	p += snprintf (p, pend-p, "OPTION cache-ttl=%u\n", _cacheTtl);
+    // Ends the options only the client may set; the agent follows
+    p += snprintf (p, pend-p, "OPTION forwarded\n");
+    return ForwardToDaemon (preamble);
+}
 
-static enum ECmd MatchCommand (const char* l)
+static void RestoreDefaults (void)
 {
-    static const char* c_Cmds [cmd_NCMDS] = {	// Parallel to ECmd
-	"BYE",
-	"CONFIRM",
-	"GETINFO",
-	"GETPIN",
-	"MESSAGE",
-	"OPTION",
-	"SETDESC",
-	"SETPROMPT",
-	"SETQUALITYBAR",
-	"SETTIMEOUT",
-	"SETTITLE",
-	"SETCANCEL",
-	"SETERROR",
-	"SETNOTOK",
-	"SETOK",
-	"SETQUALITYBAR_TT",
-	"SETKEYINFO",
-	"SETREPEAT",
-	"SETREPEATERROR",
-	"CLEARPASSPHRASE"
-    };
-    unsigned i;
-    for (i = 0; i < cmd_NCMDS; ++i)
-	if (0 == strncasecmp (c_Cmds[i], l, strlen(c_Cmds[i])))
-	    break;
-    return i;
+    // Each daemon session starts from the command line state, with the X display kept open
+    _dialogType = PromptForPassword;
+    _description = DEFAULT_DESCRIPTION;
+    _errorText = NULL;
+    _displayName = _defaults.displayName;
+    strcpy (_prompt, DEFAULT_PASSWORD_PROMPT);
+    _confirms = 0;
+    _parentWindow = _defaults.parentWindow;
+    _entryTimeout = _defaults.entryTimeout;
+    _nograb = _defaults.nograb;
+    _noServerGrab = _defaults.noServerGrab;
+    _cacheTtl = _defaults.cacheTtl;
+    _cacheAllowed = false;
+    _keyinfo[0] = 0;
+    ClearMultiDescriptions();
+}
+
+static bool IsCacheUsable (void)
+{
+    // New passphrases are not cached until confirmed by use
+    return _cacheTtl && _cacheAllowed && _keyinfo[0] && !_confirms;
+}
+
+static void ClearMultiDescriptions (void)
+{
+    // Freed last to first, so the arena space is reused
+    while (_multiCount)
+	SecmemFree (_multiDesc[--_multiCount]);
+}
+
+static strblk_t CommandToken (const char* line)
+{
+    return (strblk_t) { line, strcspn (line, " \n") };
+}
+
+static bool TokenIs (strblk_t t, const char* s)
+{
+    return t.n == strlen(s) && 0 == strncasecmp (t.p, s, t.n);
+}
+
+static bool ParseSeconds (const char* s, unsigned* secs)
+{
+    // Digits only, so negative values are rejected rather than wrapped
+    unsigned long long v = 0;
+    const char* p = s;
+    for (; *p >= '0' && *p <= '9' && v <= UINT_MAX; ++p)
+	v = v*10 + (*p-'0');
+    if (p == s || *p || v > UINT_MAX)
+	return false;
+    *secs = v;
+    return true;
+}
+
+static bool IsCommentLine (const char* line)
+{
+    // Assuan ignores empty lines and lines starting with #,
+    // which lets recorded transcripts be annotated
+    return line[0] == '#' || line[0] == '\n';
 }
 
 static void RunAssuanProtocol (void)
 {
-    puts ("OK Your orders please");
-    char line [ASSUAN_LINE_LIMIT+2];
-    while (!fflush(stdout) && fgets (line, sizeof(line), stdin)) {
-	size_t linelen = strlen(line);
-	if (line[linelen-1] != '\n') {
-	    puts ("ERR line too long");
+    ResetCommandInput();
+    _inputFd = STDIN_FILENO;
+    _byePending = false;
+    _inPreamble = _daemonMode;	// Sessions there start with the client's settings
+    ReplyLine ("OK Your orders please");
+    static char* s_line = NULL;	// Command lines are kept in the secure arena
+    if (!s_line && !(s_line = SecmemKeep (ASSUAN_LINE_LIMIT+2))) {
+	ReplyLine ("ERR 83918934 out of core");
+	FlushReplies();
+	return;
+    }
+    char* line = s_line;
+    bool prewarmed = !_prewarmMode;
+    for (int r; FlushReplies() && readline_EOF != (r = ReadCommandLine (line));) {
+	if (r == readline_TooLong) {
+	    ReplyLine ("ERR line too long");
 	    break;
 	}
-	line[linelen-1] = 0;
-	const char* arg = strchr (line, ' ');
-	arg += !!arg;
+	if (IsCommentLine (line))
+	    continue;
+	// The OPTION lines come first, and may set the display
+	if (!prewarmed && cmd_OPTION != MatchCommand (CommandToken (line))) {
+	    PrewarmDialog();
+	    prewarmed = true;
+	}
+	const uint64_t start = TraceStart();
+	const enum ECmd cmd = ProcessCommand (line);
+	TraceCommand (line, CommandToken (line).n, start);
+	ReleaseHeldReplies();	// Of commands run during its dialog
+	if (cmd == cmd_BYE)
+	    break;
+	if (_byePending) {	// BYE arrived during the dialog
+	    ReplyLine ("OK closing connection");
+	    break;
+	}
+    }
+    FlushReplies();
+    memset (line, 0, ASSUAN_LINE_LIMIT+2);
+    // Session strings are released with the arena contents,
+    // once a prewarm started for a dialog never shown is done.
+    FinishPrewarmDialog();
+    SecmemEndSession();
+    RestoreDefaults();
+}
 
-	enum ECmd cmd = MatchCommand (line);
-	switch (cmd) {
-	    case cmd_BYE:	puts ("OK closing connection"); return;
-	    case cmd_CONFIRM: {
-		_dialogType = AskYesNoQuestion;
-		bool accepted = RunMainDialog();
-		puts (accepted ? "OK" : "ERR 83886179 cancelled");
-	    }   break;
-	    case cmd_GETPIN: {
-		_dialogType = PromptForPassword;
-		bool accepted = RunMainDialog();
-		if (accepted) {
-		    PercentEscape (_password, sizeof(_password)-3);
-		    if (_confirms)
-			puts ("S PIN_REPEATED");
-		    printf ("D %s\nOK\n", _password);
-		} else
-		    puts ("ERR 83886179 cancelled");
-		memset (_password, _passwordLen = 0, sizeof(_password));
-	    }   break;
-	    case cmd_GETINFO:
-		if (!arg) {
-		    puts ("ERR argument required");
-		    break;
+edlginput_t OnDialogInput (void)
+{
+    if (!IsCommandLinePending()) {
+	ReadCommandInput();
+	if (!IsCommandLinePending())
+	    return dlginput_Continue;	// Only a part of the line arrived
+    }
+    // When the held replies are full, the dialog is cancelled,
+    // and the rest of the commands are run after it.
+    if (!CanHoldReply())
+	return dlginput_Cancel;
+    // The line being processed by RunAssuanProtocol is still in use
+    static char* s_line = NULL;
+    if (!s_line && !(s_line = SecmemKeep (ASSUAN_LINE_LIMIT+2)))
+	return dlginput_Cancel;
+    char* line = s_line;
+    // At EOF, or on a line too long, nothing is read, and
+    // RunAssuanProtocol handles it after the dialog is cancelled.
+    if (readline_Ok != ReadCommandLine (line))
+	return dlginput_Cancel;
+    if (IsCommentLine (line))
+	return dlginput_Continue;
+    if (cmd_BYE == MatchCommand (CommandToken (line))) {
+	// Cancel the dialog, reply to its command, then to BYE
+	_byePending = true;
+	return dlginput_Cancel;
+    }
+    HoldReplies (true);
+    enum ECmd cmd = ProcessCommand (line);
+    HoldReplies (false);
+    memset (line, 0, ASSUAN_LINE_LIMIT+2);
+    return ChangesLayout (cmd) ? dlginput_Relayout : dlginput_Continue;
+}
+
+static bool ChangesLayout (enum ECmd cmd)
+{
+    // Commands setting what the dialog shows, or which rows it has
+    return cmd == cmd_SETDESC || cmd == cmd_SETERROR || cmd == cmd_SETPROMPT
+	|| cmd == cmd_SETREPEAT || cmd == cmd_SETREPEATERROR || cmd == cmd_SETQUALITYBAR
+	|| cmd == cmd_SETOK || cmd == cmd_SETCANCEL || cmd == cmd_SETNOTOK || cmd == cmd_SETTITLE;
+}
+
+static bool RunDialog (edlgtype_t dlgtype)
+{
+    _dialogType = dlgtype;
+    _inDialog = true;
+    bool accepted = RunMainDialog();
+    _inDialog = false;
+    // The error applies only to the attempt it was set for
+    SecmemFree (_errorText);
+    _errorText = NULL;
+    return accepted;
+}
+
+// Returns the command executed; cmd_BYE when the connection is to be closed
+static enum ECmd ProcessCommand (char* line)
+{
+    line[strcspn (line, "\n")] = 0;
+    // The argument is the rest of the line after the command and a space
+    const strblk_t cmdtok = CommandToken (line);
+    const char* arg = cmdtok.p[cmdtok.n] ? &cmdtok.p[cmdtok.n+1] : NULL;
+    const strblk_t argtok = { arg, arg ? strlen(arg) : 0 };
+
+    enum ECmd cmd = MatchCommand (cmdtok);
+    if (_inDialog && (cmd == cmd_CONFIRM || cmd == cmd_GETPIN || cmd == cmd_MESSAGE || cmd == cmd_GETPINS || cmd == cmd_SETMULTI)) {
+	ReplyLine ("ERR 83886344 nested commands");
+	return cmd;
+    }
+    switch (cmd) {
+	case cmd_BYE:	ReplyLine ("OK closing connection"); break;
+	case cmd_CONFIRM: {
+	    bool accepted = RunDialog (AskYesNoQuestion);
+	    if (!_dialogFailed)
+		ReplyLine (accepted ? "OK" : "ERR 83886179 cancelled");
+	}   break;
+	case cmd_GETPIN: {
+	    // The cache is skipped when retrying after a wrong passphrase
+	    if (IsCacheUsable() && !_errorText && KeepEntryBuffers()
+		    && KeycacheLookup (_keyinfo, _password, PASSWORD_MAXLEN, &_passwordLen)) {
+		ReplyLine ("S PASSWORD_FROM_CACHE");
+		ReplyData (_password, _passwordLen);
+		ReplyLine ("OK");
+		memset (_password, _passwordLen = 0, PASSWORD_MAXLEN);
+		break;
+	    }
+	    bool accepted = RunDialog (PromptForPassword);
+	    if (accepted) {
+		if (_confirms)
+		    ReplyLine ("S PIN_REPEATED");
+		else if (IsCacheUsable())
+		    KeycacheStore (_keyinfo, _password, _passwordLen, _cacheTtl);
+		ReplyData (_password, _passwordLen);
+		ReplyLine ("OK");
+	    } else if (!_dialogFailed)
+		ReplyLine ("ERR 83886179 cancelled");
+	    if (_password)
+		memset (_password, _passwordLen = 0, PASSWORD_MAXLEN);
+	}   break;
+	case cmd_GETPINS: {
+	    if (!_multiCount) {
+		ReplyLine ("ERR 83886138 no passphrases set with SETMULTI");
+		break;
+	    }
+	    bool accepted = RunDialog (PromptForPasswords);
+	    if (accepted) {
+		// Clients join D lines into one buffer, so the passphrases are
+		// separated by newlines, which can not be typed into them.
+		// Packed in place, since each is shorter than its slot.
+		size_t n = 0;
+		for (unsigned i = 0; i < _multiCount; ++i) {
+		    if (i)
+			_multiPasswords[n++] = '\n';
+		    memmove (&_multiPasswords[n], &_multiPasswords[i*PASSWORD_MAXLEN], _multiLen[i]);
+		    n += _multiLen[i];
 		}
-		if (!strcasecmp (arg, "version"))
-		    puts ("D " PINENTRY_VERSTRING "\nOK");
-		else if (!strcasecmp (arg, "flavor"))
-		    puts ("D xlib\nOK");
-		else if (!strcasecmp (arg, "ttyinfo"))
-		    printf ("D - - %s\nOK", _displayName);
-		else if (!strcasecmp (arg, "pid"))
-		    printf ("D %u\nOK\n", getpid());
-		else
-		    puts ("ERR 83886355 unknown command");
+		ReplyData (_multiPasswords, n);
+		ReplyLine ("OK");
+	    } else if (!_dialogFailed)
+		ReplyLine ("ERR 83886179 cancelled");
+	    if (_multiPasswords)
+		memset (_multiPasswords, 0, MULTI_MAX*PASSWORD_MAXLEN);
+	    memset (_multiLen, 0, sizeof(_multiLen));
+	    ClearMultiDescriptions();
+	}   break;
+	case cmd_GETINFO:
+	    if (!arg) {
+		ReplyLine ("ERR argument required");
 		break;
-	    case cmd_MESSAGE:
-		_dialogType = ShowMessage;
-		RunMainDialog();
-		puts ("OK");
+	    }
+	    if (TokenIs (argtok, "version"))
+		ReplyLine ("D " PINENTRY_VERSTRING "\nOK");
+	    else if (TokenIs (argtok, "flavor"))
+		ReplyLine ("D xlib\nOK");
+	    else if (TokenIs (argtok, "ttyinfo"))
+		ReplyF ("D - - %s\nOK\n", _displayName ? _displayName : "-");
+	    else if (TokenIs (argtok, "pid"))
+		ReplyF ("D %u\nOK\n", getpid());
+	    else if (TokenIs (argtok, "renderpath"))
+		ReplyF ("D %s\nOK\n", DialogRenderPath());
+	    else if (TokenIs (argtok, "servergrab"))
+		ReplyF ("D %lu\nOK\n", _serverGrabUsec);
+	    else if (TokenIs (argtok, "framessaved"))
+		ReplyF ("D %lu\nOK\n", _framesSaved);
+	    else if (TokenIs (argtok, "stats")) {
+		char stats [ASSUAN_LINE_LIMIT-2];
+		StatsFormat (stats, sizeof(stats));
+		ReplyData (stats, strlen (stats));
+		ReplyLine ("OK");
+	    }
+	    else if (TokenIs (argtok, "cache")) {
+		const keycachestats_t cs = KeycacheStats();
+		ReplyF ("D hits=%u misses=%u stores=%u clears=%u\nOK\n", cs.hits, cs.misses, cs.stores, cs.clears);
+	    }
+	    else
+		ReplyLine ("ERR 83886355 unknown command");
+	    break;
+	case cmd_MESSAGE:
+	    RunDialog (ShowMessage);
+	    if (!_dialogFailed)
+		ReplyLine ("OK");
+	    break;
+	case cmd_OPTION: {
+	    if (!arg) {
+		ReplyLine ("ERR argument required");
 		break;
-	    case cmd_OPTION: {
-		if (!arg) {
-		    puts ("ERR argument required");
+	    }
+	    // Options are name or name=value
+	    const strblk_t name = { arg, strcspn (arg, "=") };
+	    const char* value = name.p[name.n] ? &name.p[name.n+1] : NULL;
+	    if (TokenIs (name, "no-grab"))
+		_nograb = true;
+	    else if (TokenIs (name, "grab"))
+		_nograb = false;
+	    else if (TokenIs (name, "no-server-grab"))
+		_noServerGrab = true;
+	    else if (TokenIs (name, "allow-external-password-cache"))
+		_cacheAllowed = true;
+	    else if (TokenIs (name, "cache-ttl") && value) {
+		if (!_inPreamble) {
+		    ReplyLine ("ERR 83886254 unknown option");
 		    break;
-		}
-		const char* value = strchr (arg, '=');
-		value += !!value;
-		if (!strcasecmp (arg, "no-grab"))
-		    _nograb = true;
-		else if (!strcasecmp (arg, "grab"))
-		    _nograb = false;
-		else if (!strcasecmp (arg, "parent-wid") && value)
-		    _parentWindow = atoi (value);
-		else if (!strcasecmp (arg, "display") && value) {
-		    char* p = strdup (value);
-		    if (p) {
-			if (_displayName)
-			    free (_displayName);
-			_displayName = p;
-		    }
-		}
-		puts ("OK");
-	    }	break;
-	    case cmd_SETDESC: {
-		if (!arg) {
-		    puts ("ERR argument required");
+		} else if (!ParseSeconds (value, &_cacheTtl)) {
+		    ReplyLine ("ERR 83886135 invalid value");
 		    break;
 		}
-		PercentUnescape (line, sizeof(line));
-		char* p = strdup (arg);
-		if (p) {
-		    if (_description)
-			free (_description);
-		    _description = p;
-		}
-		puts ("OK");
-	    }   break;
-	    case cmd_SETPROMPT:
-		if (!arg) {
-		    puts ("ERR argument required");
+	    } else if (TokenIs (name, "forwarded"))
+		_inPreamble = false;
+	    else if (TokenIs (name, "server-grab"))
+		_noServerGrab = false;
+	    else if (TokenIs (name, "parent-wid") && value)
+		_parentWindow = atoi (value);
+	    else if (TokenIs (name, "display") && value) {
+		// Freeing first lets a replacement reuse the space,
+		// after the prewarm has connected to the old one.
+		FinishPrewarmDialog();
+		SecmemFree (_displayName);
+		if (!(_displayName = SecmemStrdup (value))) {
+		    _displayName = _defaults.displayName;
+		    ReplyLine ("ERR 83918934 out of core");
 		    break;
 		}
-		PercentUnescape (line, sizeof(line));
-		UnderscoreUnescape (line, sizeof(line));
-		snprintf (_prompt, sizeof(_prompt), "%s:", arg);
-		puts ("OK");
+	    }
+	    ReplyLine ("OK");
+	}	break;
+	case cmd_SETDESC: {
+	    if (!arg) {
+		ReplyLine ("ERR argument required");
 		break;
-	    case cmd_SETREPEAT:
-	    case cmd_SETREPEATERROR:
-	    case cmd_SETQUALITYBAR:
-		_confirms = true;
-		if (!_prompt[0])
-		    strcpy (_prompt, "Passphrase:");
-		puts ("OK");
+	    }
+	    SecmemFree (_description);
+	    char* p = SecmemAlloc (argtok.n+1);
+	    if (!p) {
+		_description = DEFAULT_DESCRIPTION;
+		ReplyLine ("ERR 83918934 out of core");
 		break;
-	    case cmd_SETTIMEOUT:
-		if (!arg) {
-		    puts ("ERR argument required");
-		    break;
-		}
-		_entryTimeout = atoi(arg);
-		puts ("OK");
+	    }
+	    PercentUnescape (p, argtok.p, argtok.n);
+	    _description = p;
+	    ReplyLine ("OK");
+	}   break;
+	case cmd_SETMULTI: {
+	    if (!arg) {
+		ReplyLine ("ERR argument required");
 		break;
-	    case cmd_SETKEYINFO:	// no key info is displayed
-	    case cmd_CLEARPASSPHRASE:	// the passphrase is not cached
-	    case cmd_SETTITLE:		// this program's UI has no buttons
-	    case cmd_SETCANCEL:
-	    case cmd_SETERROR:
-	    case cmd_SETNOTOK:
-	    case cmd_SETOK:
-	    case cmd_SETQUALITYBAR_TT:	// or tooltips
-		puts ("OK");	// pretend everything went fine
+	    }
+	    if (_multiCount >= MULTI_MAX) {
+		ReplyLine ("ERR 83886147 too many passphrases");
 		break;
-	    default:
-		puts ("ERR 83886355 unknown command");
+	    }
+	    char* p = SecmemAlloc (argtok.n+1);
+	    if (!p) {
+		ReplyLine ("ERR 83918934 out of core");
 		break;
-	}
-    }
-}
-
-static const char hexchars[] = "0123456789ABCDEF";
-
-static void PercentEscape (char* s, size_t smaxlen)
-{
-    for (size_t i = 0; i < smaxlen; ++i) {
-	const unsigned char c = s[i];
-	if (!c)
+	    }
+	    PercentUnescape (p, argtok.p, argtok.n);
+	    _multiDesc[_multiCount++] = p;
+	    ReplyLine ("OK");
+	}   break;
+	case cmd_SETPROMPT: {
+	    if (!arg) {
+		ReplyLine ("ERR argument required");
+		break;
+	    }
+	    char prompt [ASSUAN_LINE_LIMIT];
+	    PercentUnescape (prompt, argtok.p, argtok.n);
+	    UnderscoreUnescape (prompt, sizeof(prompt));
+	    snprintf (_prompt, sizeof(_prompt), "%.*s:", (int) sizeof(_prompt)-2, prompt);
+	    ReplyLine ("OK");
+	}   break;
+	case cmd_SETREPEAT:
+	case cmd_SETREPEATERROR:
+	case cmd_SETQUALITYBAR:
+	    _confirms = true;
+	    if (!_prompt[0])
+		strcpy (_prompt, "Passphrase:");
+	    ReplyLine ("OK");
 	    break;
-	if (c < ' ' || c > '~' || c == '%') {
-	    memmove (&s[i+2], &s[i], smaxlen-i);
-	    s[i+0] = '%';
-	    s[i+1] = hexchars[c>>4];
-	    s[i+2] = hexchars[c&0xf];
-	    i += 2;
-	}
-    }
-    s[smaxlen] = 0;
-}
-
-static void PercentUnescape (char* s, size_t smaxlen)
-{
-    char* d = s;
-    for (size_t i = 0; i < smaxlen; ++i) {
-	char *hnib, *lnib, c = s[i];
-	if (c == '%' && (hnib = strchr(hexchars,toupper(s[i+1]))) && (lnib = strchr(hexchars,toupper(s[i+2])))) {
-	    c = ((hnib-hexchars)<<4)|(lnib-hexchars);
-	    i += 2;
-	}
-	*d++ = c;
-	if (!c)
+	case cmd_SETERROR: {
+	    if (!arg) {
+		ReplyLine ("ERR argument required");
+		break;
+	    }
+	    SecmemFree (_errorText);
+	    char* p = SecmemAlloc (argtok.n+1);
+	    if (!p) {
+		_errorText = NULL;
+		ReplyLine ("ERR 83918934 out of core");
+		break;
+	    }
+	    PercentUnescape (p, argtok.p, argtok.n);
+	    _errorText = p;
+	    ReplyLine ("OK");
+	}   break;
+	case cmd_SETTIMEOUT:
+	    if (!arg) {
+		ReplyLine ("ERR argument required");
+		break;
+	    }
+	    _entryTimeout = atoi(arg);
+	    ReplyLine ("OK");
+	    break;
+	case cmd_SETKEYINFO:	// Only used to name the cached passphrase
+	    if (!arg || 0 == strcmp (arg, "--clear") || strlen (arg) >= sizeof(_keyinfo))
+		_keyinfo[0] = 0;
+	    else
+		strcpy (_keyinfo, arg);
+	    ReplyLine ("OK");
+	    break;
+	case cmd_CLEARPASSPHRASE:
+	    if (arg)
+		KeycacheClear (arg);
+	    ReplyLine ("OK");
+	    break;
+	case cmd_SETTITLE:		// this program's UI has no buttons
+	case cmd_SETCANCEL:
+	case cmd_SETNOTOK:
+	case cmd_SETOK:
+	case cmd_SETQUALITYBAR_TT:	// or tooltips
+	    ReplyLine ("OK");	// pretend everything went fine
 	    break;
+    default:
+	ReplyLine ("ERR 83886355 unknown command");
+	break;
     }
+    return cmd;
 }
 
 static void UnderscoreUnescape (char* s, size_t smaxlen)
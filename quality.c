@@ -0,0 +1,373 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "quality.h"
+#include "xdlg.h"
+#include "secmem.h"
+#include <stdint.h>
+#include <time.h>
+
+//----------------------------------------------------------------------
+// All scores are log2(guesses)*16, to avoid linking with -lm.
+// _qbits[n] is the cheapest way to guess the first n characters, as a
+// chain of patterns and brute-forced characters. Each new character
+// adds the patterns that end with it to the best score before them.
+
+enum {
+    BITS_DIGIT = 53,		// log2(10)*16
+    BITS_LETTER = 75,		// log2(26)*16
+    BITS_SYMBOL = 81,		// log2(33)*16
+    BITS_KEY_START = 89,	// log2(47 keys)*16
+    BITS_KEY_TURN = 35,		// log2(4.6 neighbors per key)*16
+    BITS_SEPARATOR = 32,	// One of four common date separators
+    BITS_PATTERN = 48,		// Choosing which kind of pattern comes next
+    MIN_YEAR_SPACE = 20,	// Years are guessed this close to now
+    MAX_VARIATION_LEN = 32,	// Longer runs are far into brute force range
+    NO_WORD = 255
+};
+
+// A trie edge from dict.h, built by mkdict.awk from dict.txt
+typedef struct {
+    unsigned char	c;	// The letter; 0x80 is set on the last edge of a node
+    unsigned char	bits;	// Score of the word ending here, or NO_WORD
+    unsigned short	next;	// First edge of the next node, 0 if none
+} dictedge_t;
+
+static const dictedge_t c_Dict[] = {
+#include "dict.h"
+};
+
+// Symbols typed in place of letters, as symbol-letter pairs
+static const char c_Leet[] = "4a@a8b(c{c[c<c3e6g9g1i1l!i|i|l0o$s5s+t7l7t%x2z";
+
+// US keyboard rows, unshifted then shifted. The rows are staggered, so
+// the keys above column c are at c and c+1, and those below at c-1 and c.
+static const char c_KeyRows [8][14] = {
+    "1234567890-=", "qwertyuiop[]\\", "asdfghjkl;'", "zxcvbnm,./",
+    "!@#$%^&*()_+", "QWERTYUIOP{}|", "ASDFGHJKL:\"", "ZXCVBNM<>?"
+};
+
+static unsigned short* _qbits = NULL;
+static size_t _qlen = 0;
+
+static inline bool IsDigit (char c) { return c >= '0' && c <= '9'; }
+static inline bool IsLower (char c) { return c >= 'a' && c <= 'z'; }
+static inline bool IsUpper (char c) { return c >= 'A' && c <= 'Z'; }
+static inline unsigned Min (unsigned a, unsigned b) { return a < b ? a : b; }
+
+static unsigned Log2x16 (uint64_t n);
+static unsigned VariationBits (unsigned n, unsigned k);
+static unsigned CharClass (char c);
+static unsigned ScoreEnd (const char* pw, size_t end);
+static unsigned DictionaryWalk (const char* pw, size_t end, size_t i, unsigned e, unsigned nsubs, unsigned best);
+static unsigned CaseBits (const char* w, size_t n);
+static unsigned RepeatMatches (const char* pw, size_t end, unsigned best);
+static unsigned SequenceMatches (const char* pw, size_t end, unsigned best);
+static int KeyPosition (char c);
+static unsigned KeyDirection (char a, char b);
+static unsigned KeyboardMatches (const char* pw, size_t end, unsigned best);
+static unsigned YearBits (unsigned year);
+static unsigned DayMonthYearBits (unsigned a, unsigned b, unsigned y, size_t ylen);
+static unsigned DateBits (const char* s, size_t n);
+static unsigned DateMatches (const char* pw, size_t end, unsigned best);
+
+//----------------------------------------------------------------------
+
+void QualityUpdate (const char* pw, size_t len)
+{
+    if (!_qbits) {
+	if (!(_qbits = SecmemKeep ((PASSWORD_MAXLEN+1)*sizeof(_qbits[0]))))
+	    return;
+	_qbits[0] = 0;
+    }
+    if (len > PASSWORD_MAXLEN)
+	len = PASSWORD_MAXLEN;
+    // The last character may have been replaced, so it is always rescored
+    if (_qlen >= len)
+	_qlen = len ? len-1 : 0;
+    while (_qlen < len) {
+	++_qlen;
+	_qbits[_qlen] = ScoreEnd (pw, _qlen);
+    }
+}
+
+unsigned QualityBits (void)
+{
+    return _qbits ? _qbits[_qlen]/16 : 0;
+}
+
+static unsigned ScoreEnd (const char* pw, size_t end)
+{
+    static const unsigned char c_ClassBits[4] = { BITS_DIGIT, BITS_LETTER, BITS_LETTER, BITS_SYMBOL };
+    const unsigned brute = _qbits[end-1] + c_ClassBits [CharClass (pw[end-1])];
+    unsigned best = UINT_MAX;
+    best = DictionaryWalk (pw, end, end, 0, 0, best);
+    best = RepeatMatches (pw, end, best);
+    best = SequenceMatches (pw, end, best);
+    best = KeyboardMatches (pw, end, best);
+    best = DateMatches (pw, end, best);
+    return best < brute ? Min (brute, best + BITS_PATTERN) : brute;
+}
+
+//----------------------------------------------------------------------
+// Scoring helpers
+
+static unsigned Log2x16 (uint64_t n)
+{
+    // Integer part from the top bit, fraction from the four below it
+    static const unsigned char c_Frac[16] = { 0,1,3,4,5,6,7,8,9,10,11,12,13,14,15,15 };
+    if (n <= 1)
+	return 0;
+    const unsigned top = 63 - __builtin_clzll (n);
+    const unsigned frac = (top >= 4 ? n >> (top-4) : n << (4-top)) & 15;
+    return top*16 + c_Frac[frac];
+}
+
+static unsigned VariationBits (unsigned n, unsigned k)
+{
+    // Ways to pick which of n characters, up to k, are changed
+    if (n > MAX_VARIATION_LEN)
+	n = MAX_VARIATION_LEN;
+    if (k > n)
+	k = n;
+    if (k > n-k)
+	k = n-k;
+    uint64_t sum = 0, c = 1;
+    for (unsigned i = 1; i <= k; ++i)
+	sum += (c = c*(n-i+1)/i);
+    return sum > 2 ? Log2x16 (sum) : 16;
+}
+
+static unsigned CharClass (char c)
+{
+    return IsDigit(c) ? 0 : IsLower(c) ? 1 : IsUpper(c) ? 2 : 3;
+}
+
+//----------------------------------------------------------------------
+// Dictionary words, with capitals and leet substitutions
+
+static unsigned DictionaryWalk (const char* pw, size_t end, size_t i, unsigned e, unsigned nsubs, unsigned best)
+{
+    // The trie is reversed, so words ending at end are found by
+    // following pw[i-1] from the node starting at edge e.
+    if (!i)
+	return best;
+    const char c = IsUpper (pw[i-1]) ? pw[i-1]-'A'+'a' : pw[i-1];
+    char letters[2];
+    unsigned nletters = 0, subs = nsubs;
+    if (IsLower (c))
+	letters[nletters++] = c;
+    else {
+	for (const char* l = c_Leet; *l && nletters < 2; l += 2)
+	    if (*l == c)
+		letters[nletters++] = l[1];
+	++subs;
+    }
+    for (unsigned li = 0; li < nletters; ++li) {
+	for (unsigned j = e;; ++j) {
+	    if ((c_Dict[j].c & 0x7f) == letters[li]) {
+		if (c_Dict[j].bits != NO_WORD) {
+		    const size_t n = end-(i-1);
+		    unsigned b = _qbits[i-1] + c_Dict[j].bits + CaseBits (&pw[i-1], n);
+		    if (subs)
+			b += VariationBits (n, subs);
+		    best = Min (best, b);
+		}
+		if (c_Dict[j].next)
+		    best = DictionaryWalk (pw, end, i-1, c_Dict[j].next, subs, best);
+		break;
+	    }
+	    if (c_Dict[j].c & 0x80)
+		break;
+	}
+    }
+    return best;
+}
+
+static unsigned CaseBits (const char* w, size_t n)
+{
+    unsigned upper = 0, lower = 0;
+    for (size_t i = 0; i < n; ++i) {
+	upper += IsUpper (w[i]);
+	lower += IsLower (w[i]);
+    }
+    if (!upper)
+	return 0;
+    // All caps and a capital at either end are tried first
+    if (!lower || (upper == 1 && (IsUpper (w[0]) || IsUpper (w[n-1]))))
+	return 16;
+    return VariationBits (upper+lower, Min (upper, lower));
+}
+
+//----------------------------------------------------------------------
+// Repeats, like "aaaa" or "abcabc"
+
+static unsigned RepeatMatches (const char* pw, size_t end, unsigned best)
+{
+    // For each period b, the run of characters equal to those b before.
+    // At least one full copy must repeat; the copy costs its period and length.
+    for (size_t b = 1; 2*b <= end; ++b) {
+	size_t t = 0;
+	while (t < end-b && pw[end-1-t] == pw[end-1-t-b])
+	    ++t;
+	for (size_t s = b; s <= t; ++s)
+	    best = Min (best, _qbits[end-s] + Log2x16 (2*b*s));
+    }
+    return best;
+}
+
+//----------------------------------------------------------------------
+// Sequences, like "abcd", "9753", or "XYZ"
+
+static unsigned SequenceMatches (const char* pw, size_t end, unsigned best)
+{
+    if (end < 3)
+	return best;
+    const int d = pw[end-1] - pw[end-2];
+    const unsigned cls = CharClass (pw[end-1]);
+    if (!d || d < -5 || d > 5 || cls == 3 || cls != CharClass (pw[end-2]))
+	return best;
+    for (size_t s = 2; s < end && pw[end-s]-pw[end-s-1] == d && cls == CharClass (pw[end-s-1]);) {
+	const char first = pw[end-(++s)];
+	const unsigned base = strchr ("aAzZ019", first) ? 4 : cls ? 26 : 10;
+	best = Min (best, _qbits[end-s] + Log2x16 ((uint64_t) base * s * abs(d) * (d < 0 ? 2 : 1)));
+    }
+    return best;
+}
+
+//----------------------------------------------------------------------
+// Keyboard walks, like "qwerty" or "zaq1@WSX"
+
+static int KeyPosition (char c)
+{
+    // Returns row*16+col, with the row of shifted keys offset by 4
+    for (unsigned r = 0; r < 8; ++r) {
+	const char* k = strchr (c_KeyRows[r], c);
+	if (k)
+	    return r*16 + (k - c_KeyRows[r]);
+    }
+    return -1;
+}
+
+static unsigned KeyDirection (char a, char b)
+{
+    // Returns a nonzero direction if b is next to a
+    const int pa = KeyPosition (a), pb = KeyPosition (b);
+    if (pa < 0 || pb < 0)
+	return 0;
+    const int dr = (pb/16)%4 - (pa/16)%4, dc = pb%16 - pa%16;
+    if ((dr == 0 && (dc == 1 || dc == -1))
+	    || (dr == -1 && (dc == 0 || dc == 1))
+	    || (dr == 1 && (dc == 0 || dc == -1)))
+	return 1 + (dr+1)*3 + (dc+1);
+    return 0;
+}
+
+static unsigned KeyboardMatches (const char* pw, size_t end, unsigned best)
+{
+    // Walking back from the end, the cost is the start key,
+    // a neighbor choice for each change of direction, and shifts.
+    unsigned turns = 0, dir = 0, shifted = KeyPosition (pw[end-1]) >= 64;
+    for (size_t j = end-1; j > 0; --j) {
+	const unsigned d = KeyDirection (pw[j-1], pw[j]);
+	if (!d)
+	    break;
+	turns += d != dir;
+	dir = d;
+	shifted += KeyPosition (pw[j-1]) >= 64;
+	const size_t s = end-j+1;
+	if (s < 3)
+	    continue;
+	unsigned b = BITS_KEY_START + turns*BITS_KEY_TURN + Log2x16 (s);
+	if (shifted)
+	    b += shifted == s ? 16 : VariationBits (s, shifted);
+	best = Min (best, _qbits[j-1] + b);
+    }
+    return best;
+}
+
+//----------------------------------------------------------------------
+// Dates, like "1987", "4/7/92", or "19921204"
+
+static unsigned YearBits (unsigned year)
+{
+    static unsigned s_now = 0;
+    if (!s_now)
+	s_now = 1970 + time (NULL)/31556952;
+    const unsigned space = year > s_now ? year-s_now : s_now-year;
+    return Log2x16 (space > MIN_YEAR_SPACE ? space : MIN_YEAR_SPACE);
+}
+
+static unsigned DayMonthYearBits (unsigned a, unsigned b, unsigned y, size_t ylen)
+{
+    // Day and month may be in either order
+    if (!a || !b || ((a > 12 || b > 31) && (b > 12 || a > 31)))
+	return UINT_MAX;
+    if (ylen == 2)
+	y += y < 50 ? 2000 : 1900;
+    else if (ylen != 4 || y < 1000 || y > 2050)
+	return UINT_MAX;
+    return Log2x16 (365) + YearBits (y);
+}
+
+static unsigned DateBits (const char* s, size_t n)
+{
+    // Splits s into three groups of digits, at a repeated separator, or
+    // anywhere if there is none, and tries the year at either end.
+    size_t sa = 0, sb = 0;
+    for (size_t i = 0; i < n; ++i) {
+	if (IsDigit (s[i]))
+	    continue;
+	if (!sa && strchr (" -/._\\", s[i]))
+	    sa = i;
+	else if (!sb && s[i] == s[sa])
+	    sb = i;
+	else
+	    return UINT_MAX;
+    }
+    if (sa && !sb)
+	return UINT_MAX;
+    unsigned best = UINT_MAX;
+    if (!sa && n == 4) {
+	const unsigned y = ((s[0]-'0')*10 + s[1]-'0')*100 + (s[2]-'0')*10 + s[3]-'0';
+	if (y >= 1900 && y <= 2099)	// Years alone
+	    best = YearBits (y);
+    }
+    for (size_t a = sa ? sa : 1; a+2 <= n; a = sa ? n : a+1) {
+	for (size_t b = sb ? sb : a+1; b+1 <= n; b = sb ? n : b+1) {
+	    const size_t l1 = a, l2 = b-a-!!sa, l3 = n-b-!!sb;
+	    if (!l1 || !l2 || !l3 || l1 > 4 || l2 > 4 || l3 > 4)
+		continue;
+	    unsigned v1 = 0, v2 = 0, v3 = 0;
+	    for (size_t i = 0; i < l1; ++i)
+		v1 = v1*10 + s[i]-'0';
+	    for (size_t i = b-l2; i < b; ++i)
+		v2 = v2*10 + s[i]-'0';
+	    for (size_t i = n-l3; i < n; ++i)
+		v3 = v3*10 + s[i]-'0';
+	    if (l1 <= 2 && l2 <= 2)
+		best = Min (best, DayMonthYearBits (v1, v2, v3, l3));
+	    if (l2 <= 2 && l3 <= 2)
+		best = Min (best, DayMonthYearBits (v2, v3, v1, l1));
+	}
+    }
+    if (best != UINT_MAX && sa)
+	best += BITS_SEPARATOR;
+    return best;
+}
+
+static unsigned DateMatches (const char* pw, size_t end, unsigned best)
+{
+    if (!IsDigit (pw[end-1]))
+	return best;
+    for (size_t n = 4; n <= 10 && n <= end; ++n) {
+	if (!IsDigit (pw[end-n]))
+	    continue;
+	const unsigned b = DateBits (&pw[end-n], n);
+	if (b != UINT_MAX)
+	    best = Min (best, _qbits[end-n] + b);
+    }
+    return best;
+}
@@ -0,0 +1,16 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "config.h"
+
+//----------------------------------------------------------------------
+// Password strength, as log2 of the guesses needed by an attacker who
+// tries dictionary words, keyboard walks, repeats, sequences, and dates
+// before brute force. Each prefix of the password is scored once, so
+// call QualityUpdate after every edit to score only the last character.
+
+void QualityUpdate (const char* pw, size_t len);
+unsigned QualityBits (void);
@@ -0,0 +1,139 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "secmem.h"
+#include <sys/mman.h>
+
+//----------------------------------------------------------------------
+
+enum {
+    SECMEM_SIZE = 32*1024,	// Under the usual 64k RLIMIT_MEMLOCK
+    SECMEM_ALIGN = sizeof(size_t)
+};
+
+static char* _arena = NULL;
+static size_t _sessionTop = 0;		// End of session allocations
+static size_t _keepBottom = SECMEM_SIZE;	// Start of kept buffers
+
+// Session blocks are preceded by their size, with this bit set when freed
+enum { BLOCK_FREE = 1 };
+
+static size_t AlignUp (size_t n) { return (n + SECMEM_ALIGN-1) & ~(SECMEM_ALIGN-1); }
+static size_t* BlockHeader (size_t off) { return (size_t*) &_arena[off]; }
+
+static void* ReuseFreeBlock (size_t n);
+
+//----------------------------------------------------------------------
+
+bool SecmemInit (void)
+{
+    if (_arena)
+	return true;
+    void* p = mmap (NULL, SECMEM_SIZE, PROT_READ| PROT_WRITE, MAP_PRIVATE| MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+	return false;
+    _arena = p;
+    // Locking may fail when over the limit; the arena is still kept out of core dumps
+    mlock (_arena, SECMEM_SIZE);
+    madvise (_arena, SECMEM_SIZE, MADV_DONTDUMP);
+    atexit (SecmemWipe);
+    return true;
+}
+
+void* SecmemKeep (size_t n)
+{
+    n = AlignUp (n);
+    if (!_arena || n > _keepBottom - _sessionTop)
+	return NULL;
+    _keepBottom -= n;
+    return &_arena[_keepBottom];
+}
+
+void* SecmemAlloc (size_t n)
+{
+    n = AlignUp (n);
+    if (!_arena)
+	return NULL;
+    void* p = ReuseFreeBlock (n);
+    if (p || n+sizeof(size_t) > _keepBottom - _sessionTop)
+	return p;
+    *(size_t*) &_arena[_sessionTop] = n;
+    _sessionTop += sizeof(size_t);
+    p = &_arena[_sessionTop];
+    _sessionTop += n;
+    return p;
+}
+
+static void* ReuseFreeBlock (size_t n)
+{
+    // First fit, merging each free block with the free ones after it.
+    // Session strings are few, so the walk is short.
+    for (size_t off = 0; off < _sessionTop;) {
+	size_t* h = BlockHeader (off), bn = *h & ~BLOCK_FREE;
+	if (*h & BLOCK_FREE) {
+	    for (size_t next; (next = off+sizeof(size_t)+bn) < _sessionTop && (*BlockHeader (next) & BLOCK_FREE);)
+		bn += sizeof(size_t) + (*BlockHeader (next) & ~BLOCK_FREE);
+	    *h = bn | BLOCK_FREE;
+	    if (bn >= n) {
+		// The rest is split off if it can hold a block
+		if (bn-n > sizeof(size_t)) {
+		    *BlockHeader (off+sizeof(size_t)+n) = (bn-n-sizeof(size_t)) | BLOCK_FREE;
+		    bn = n;
+		}
+		*h = bn;
+		char* p = &_arena[off+sizeof(size_t)];
+		memset (p, 0, bn);	// Clears the merged headers
+		return p;
+	    }
+	}
+	off += sizeof(size_t)+bn;
+    }
+    return NULL;
+}
+
+char* SecmemStrdup (const char* s)
+{
+    const size_t n = strlen(s)+1;
+    char* p = SecmemAlloc (n);
+    if (p)
+	memcpy (p, s, n);
+    return p;
+}
+
+void SecmemFree (const void* p)
+{
+    // Pointers outside the session area, like string literals, are ignored.
+    // Freed blocks are reused by SecmemAlloc; the top of the area is
+    // lowered to the end of the last block still in use.
+    const char* cp = p;
+    if (!_arena || cp < &_arena[sizeof(size_t)] || cp >= &_arena[_sessionTop])
+	return;
+    const size_t off = cp - _arena;
+    size_t* h = BlockHeader (off-sizeof(size_t));
+    if (*h & BLOCK_FREE)
+	return;
+    memset (&_arena[off], 0, *h);
+    *h |= BLOCK_FREE;
+    size_t used = 0;
+    for (size_t b = 0; b < _sessionTop; b += sizeof(size_t) + (*BlockHeader (b) & ~BLOCK_FREE))
+	if (!(*BlockHeader (b) & BLOCK_FREE))
+	    used = b + sizeof(size_t) + *BlockHeader (b);
+    memset (&_arena[used], 0, _sessionTop-used);	// The free headers
+    _sessionTop = used;
+}
+
+void SecmemEndSession (void)
+{
+    if (_arena)
+	memset (_arena, 0, _sessionTop);
+    _sessionTop = 0;
+}
+
+void SecmemWipe (void)
+{
+    // Also called from signal handlers, so only memset
+    if (_arena)
+	memset (_arena, 0, SECMEM_SIZE);
+}
@@ -0,0 +1,23 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "config.h"
+#include <stdbool.h>
+
+//----------------------------------------------------------------------
+// Secrets and session strings live in one page-aligned arena, locked
+// into memory and excluded from core dumps. Buffers kept for the life of
+// the process are taken from its top, and session strings from its
+// bottom, reusing freed space, to be released together when the session
+// ends. Everything is wiped at exit.
+
+bool SecmemInit (void);
+void* SecmemKeep (size_t n);
+void* SecmemAlloc (size_t n);
+char* SecmemStrdup (const char* s);
+void SecmemFree (const void* p);
+void SecmemEndSession (void);
+void SecmemWipe (void);
@@ -0,0 +1,98 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "stats.h"
+#include <fcntl.h>
+#include <inttypes.h>
+
+//----------------------------------------------------------------------
+
+stats_t _stats = { .connects = 0 };
+
+static uint64_t _dialogStart = 0;
+
+static void AddToHist (unsigned* hist, uint64_t usec);
+static void FormatHist (char* buf, size_t bufsz, const unsigned* hist);
+static void DumpStats (void);
+
+//----------------------------------------------------------------------
+
+// Called by TracePhase, so the dialog phases are timed even when not tracing
+void StatsPhase (ephase_t phase)
+{
+    if (phase == phase_Dialog) {
+	_dialogStart = NowUsec();
+	++_stats.dialogs;
+    } else if (phase == phase_Mapped && _dialogStart)
+	_stats.mapUsec += NowUsec() - _dialogStart;
+    else if (phase == phase_Grabbed && _dialogStart)
+	_stats.grabUsec += NowUsec() - _dialogStart;
+}
+
+void StatsDraw (uint64_t usec)
+{
+    ++_stats.draws;
+    _stats.drawUsec += usec;
+    AddToHist (_stats.drawHist, usec);
+}
+
+// Each dialog replaces the last one's times, and adds to the histogram
+void StatsDialogTimes (uint64_t thinkUsec, uint64_t busyUsec)
+{
+    _stats.thinkUsec = thinkUsec;
+    _stats.busyUsec = busyUsec;
+    AddToHist (_stats.busyHist, busyUsec);
+}
+
+static void AddToHist (unsigned* hist, uint64_t usec)
+{
+    unsigned b = usec ? 64 - __builtin_clzll (usec) : 0;
+    ++hist [b < STATS_HIST_N ? b : STATS_HIST_N-1];
+}
+
+static void FormatHist (char* buf, size_t bufsz, const unsigned* hist)
+{
+    for (unsigned i = 0, hl = 0; i < STATS_HIST_N; ++i)
+	hl += snprintf (buf+hl, bufsz-hl, i ? ",%u" : "%u", hist[i]);
+}
+
+// Writes the counters as space-separated name=value pairs
+int StatsFormat (char* buf, size_t bufsz)
+{
+    char busyhist [STATS_HIST_N*11], drawhist [STATS_HIST_N*11];
+    FormatHist (busyhist, sizeof(busyhist), _stats.busyHist);
+    FormatHist (drawhist, sizeof(drawhist), _stats.drawHist);
+    return snprintf (buf, bufsz,
+	    "connects=%u connect_us=%" PRIu64 " roundtrips=%" PRIu64
+	    " dialogs=%u map_us=%" PRIu64 " grab_us=%" PRIu64 " think_us=%" PRIu64 " busy_us=%" PRIu64 " busy_hist=%s"
+	    " draws=%u draw_us=%" PRIu64 " draw_hist=%s updates=%u update_us=%" PRIu64
+	    " keys=%u timeouts=%u grabfails=%u",
+	    _stats.connects, _stats.connectUsec, _stats.roundTrips,
+	    _stats.dialogs, _stats.mapUsec, _stats.grabUsec, _stats.thinkUsec, _stats.busyUsec, busyhist,
+	    _stats.draws, _stats.drawUsec, drawhist, _stats.updates, _stats.updateUsec,
+	    _stats.keys, _stats.timeouts, _stats.grabFailures);
+}
+
+void StatsDumpAtExit (void)
+{
+    if (getenv ("PINENTRY_XLIB_STATS"))
+	atexit (DumpStats);
+}
+
+// Appended as "stats pid name=value...", one line per process
+static void DumpStats (void)
+{
+    const int fd = open (getenv ("PINENTRY_XLIB_STATS"), O_WRONLY| O_CREAT| O_APPEND| O_CLOEXEC, 0600);
+    if (fd < 0)
+	return;
+    char line [1024];
+    int linelen = snprintf (line, sizeof(line), "stats %u ", getpid());
+    linelen += StatsFormat (line+linelen, sizeof(line)-linelen-1);
+    if ((size_t) linelen > sizeof(line)-2)
+	linelen = sizeof(line)-2;
+    line[linelen++] = '\n';
+    UNUSED ssize_t bw = write (fd, line, linelen);
+    close (fd);
+}
@@ -0,0 +1,42 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "trace.h"
+
+//----------------------------------------------------------------------
+// Counters of where the time goes, kept since start. Updating one is an
+// add or two, so they are always on. GETINFO stats reports them, and they
+// are appended at exit to the file named by PINENTRY_XLIB_STATS.
+
+enum { STATS_HIST_N = 16 };	// Bucket i counts times under 2^i usec; the last is open
+
+typedef struct {
+    unsigned	connects;
+    uint64_t	connectUsec;	// In XOpenDisplay
+    uint64_t	roundTrips;	// Waits for a server reply
+    unsigned	dialogs;
+    uint64_t	mapUsec;	// From dialog request to the window mapped
+    uint64_t	grabUsec;	// From dialog request to the keyboard grabbed
+    uint64_t	thinkUsec;	// Last dialog's time waiting for the user
+    uint64_t	busyUsec;	// Last dialog's time handling events and drawing
+    unsigned	busyHist [STATS_HIST_N];	// Of busyUsec, one per dialog
+    unsigned	draws;		// Full frames
+    uint64_t	drawUsec;
+    unsigned	drawHist [STATS_HIST_N];
+    unsigned	updates;	// Frames with only the entry redrawn
+    uint64_t	updateUsec;
+    unsigned	keys;
+    unsigned	timeouts;
+    unsigned	grabFailures;
+} stats_t;
+
+extern stats_t _stats;
+
+void StatsPhase (ephase_t phase);
+void StatsDraw (uint64_t usec);
+void StatsDialogTimes (uint64_t thinkUsec, uint64_t busyUsec);
+int StatsFormat (char* buf, size_t bufsz);
+void StatsDumpAtExit (void);
@@ -0,0 +1,181 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+// Startup benchmark. Runs pinentry-xlib repeatedly on $DISPLAY, through
+// GETPIN on the Assuan interface and as ssh-askpass, and prints the
+// min, median, and p99 of the time from fork to each traced phase.
+// Without a display, the headless backend answers the dialogs, and
+// each run ends when the dialog is requested.
+
+#include "../config.h"
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <signal.h>
+#include <time.h>
+
+//----------------------------------------------------------------------
+
+enum { MAX_RUNS = 1000, GRAB_TIMEOUT_USEC = 5000000 };
+
+static const char c_PhaseNames [][12] = { "exec", "dialog", "connected", "mapped", "drawn", "grabbed" };
+enum { NPHASES = sizeof(c_PhaseNames)/sizeof(c_PhaseNames[0]) };
+
+typedef struct {
+    const char*	name;
+    uint64_t	usec [NPHASES][MAX_RUNS];
+    unsigned	n [NPHASES];
+    unsigned	failed;	// Runs that never reached the last phase
+} benchmode_t;
+
+static unsigned _lastPhase = NPHASES-1;	// Where each run ends
+
+//----------------------------------------------------------------------
+
+static uint64_t NowUsec (void);
+static bool RunOnce (const char* exe, bool askpass, const char* tracefile, benchmode_t* m);
+static bool ReadTrace (const char* tracefile, uint64_t forkUsec, benchmode_t* m, bool record);
+static int CompareUsec (const void* a, const void* b);
+static void PrintMode (benchmode_t* m);
+
+//----------------------------------------------------------------------
+
+int main (int argc, char* argv[])
+{
+    if (argc < 2) {
+	fputs ("Usage: bench PINENTRY [RUNS]\n", stderr);
+	return EXIT_FAILURE;
+    }
+    const char* exe = argv[1];
+    unsigned runs = argc > 2 ? strtoul (argv[2], NULL, 0) : 100;
+    if (!runs || runs > MAX_RUNS)
+	runs = MAX_RUNS;
+    char tracefile[] = "/tmp/pinentry-bench.XXXXXX";
+    int tfd = mkstemp (tracefile);
+    if (tfd < 0) {
+	perror ("mkstemp");
+	return EXIT_FAILURE;
+    }
+    close (tfd);
+    signal (SIGPIPE, SIG_IGN);
+    if (!getenv ("DISPLAY")) {
+	setenv ("PINENTRY_XLIB_SCRIPT", "benchmark\\r", false);
+	_lastPhase = 1;	// dialog
+    }
+
+    static benchmode_t s_Modes[2] = {{ .name = "assuan" }, { .name = "askpass" }};
+    // Alternated, so both see the same server and cache state
+    for (unsigned i = 0; i < runs; ++i)
+	for (unsigned m = 0; m < 2; ++m)
+	    if (!RunOnce (exe, m, tracefile, &s_Modes[m]))
+		++s_Modes[m].failed;
+    unlink (tracefile);
+
+    printf ("# usec from fork, %u runs\n# %-8s%-11s%10s%10s%10s\n", runs, "mode", "phase", "min", "median", "p99");
+    for (unsigned m = 0; m < 2; ++m)
+	PrintMode (&s_Modes[m]);
+    return EXIT_SUCCESS;
+}
+
+static uint64_t NowUsec (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*UINT64_C(1000000) + ts.tv_nsec/1000;
+}
+
+// Starts the dialog, waits for the last phase, then closes it:
+// with BYE on the Assuan path, and by killing the askpass process.
+static bool RunOnce (const char* exe, bool askpass, const char* tracefile, benchmode_t* m)
+{
+    if (0 != truncate (tracefile, 0))
+	return false;
+    int cmdpipe[2];
+    if (0 != pipe2 (cmdpipe, O_CLOEXEC))
+	return false;
+    const uint64_t forkUsec = NowUsec();
+    pid_t pid = fork();
+    if (pid < 0)
+	return false;
+    if (!pid) {
+	int nullfd = open ("/dev/null", O_WRONLY);
+	dup2 (cmdpipe[0], STDIN_FILENO);
+	dup2 (nullfd, STDOUT_FILENO);
+	setenv ("PINENTRY_XLIB_TRACE", tracefile, true);
+	if (askpass)
+	    execl (exe, exe, "Benchmark", NULL);
+	else
+	    execl (exe, exe, "--no-forward", NULL);
+	_exit (EXIT_FAILURE);
+    }
+    close (cmdpipe[0]);
+    if (!askpass) {
+	static const char c_Cmds[] = "SETDESC Startup benchmark\nGETPIN\n";
+	UNUSED ssize_t bw = write (cmdpipe[1], c_Cmds, sizeof(c_Cmds)-1);
+    }
+    bool reached = false, exited = false;
+    for (uint64_t start = NowUsec(); !reached && !exited && NowUsec()-start < GRAB_TIMEOUT_USEC;) {
+	// Headless, the process may be done before the trace is read
+	exited = 0 != waitpid (pid, NULL, WNOHANG);
+	reached = ReadTrace (tracefile, forkUsec, m, false);
+	if (!reached && !exited)
+	    usleep (1000);
+    }
+    if (!askpass) {
+	UNUSED ssize_t bw = write (cmdpipe[1], STRBLK("BYE\n"));
+    } else if (!exited)
+	kill (pid, SIGKILL);
+    close (cmdpipe[1]);
+    if (!exited)
+	waitpid (pid, NULL, 0);
+    return reached && ReadTrace (tracefile, forkUsec, m, true);
+}
+
+// Returns true if the trace reached the last phase; records the
+// phase times if asked to.
+static bool ReadTrace (const char* tracefile, uint64_t forkUsec, benchmode_t* m, bool record)
+{
+    FILE* f = fopen (tracefile, "r");
+    if (!f)
+	return false;
+    bool reached = false;
+    char name [32];
+    uint64_t mono, sinceExec;
+    for (char line [128]; fgets (line, sizeof(line), f);) {
+	if (3 != sscanf (line, "%31s %" SCNu64 " %" SCNu64, name, &mono, &sinceExec))
+	    continue;
+	for (unsigned p = 0; p < NPHASES; ++p) {
+	    if (0 != strcmp (name, c_PhaseNames[p]))
+		continue;
+	    if (record && m->n[p] < MAX_RUNS)
+		m->usec[p][m->n[p]++] = mono - forkUsec;
+	    reached |= p == _lastPhase;
+	}
+    }
+    fclose (f);
+    return reached;
+}
+
+static int CompareUsec (const void* a, const void* b)
+{
+    const uint64_t ua = *(const uint64_t*) a, ub = *(const uint64_t*) b;
+    return (ua > ub) - (ua < ub);
+}
+
+static void PrintMode (benchmode_t* m)
+{
+    for (unsigned p = 0; p < NPHASES; ++p) {
+	const unsigned n = m->n[p];
+	if (!n)
+	    continue;
+	qsort (m->usec[p], n, sizeof(m->usec[p][0]), CompareUsec);
+	// Nearest rank percentiles
+	printf ("  %-8s%-11s%10" PRIu64 "%10" PRIu64 "%10" PRIu64 "\n", m->name, c_PhaseNames[p],
+		m->usec[p][0], m->usec[p][(n-1)/2], m->usec[p][(99*n+99)/100-1]);
+    }
+    if (m->failed)
+	printf ("  %-8sfailed %u\n", m->name, m->failed);
+}
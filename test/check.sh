@@ -0,0 +1,33 @@
+#! /bin/sh
+#
+# This file is part of the pinentry-xlib project
+#
+# Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+# This file is free software, distributed under the MIT License.
+#
+# Checks the executable against budgets: its size in bytes, as text,
+# data, and bss, the number of shared libraries it loads, and the median
+# usec from fork to the dialog request, measured by the startup benchmark
+# with the headless backend. Usage:
+# check.sh PINENTRY BENCH MAXSIZE MAXLIBS MAXSTARTUP
+
+exe=$1
+bench=$2
+rc=0
+
+budget() {
+    if [ -z "$2" ] || [ "$2" -gt "$3" ]; then
+	echo "check: $1 ${2:-unknown}, over the budget of $3"
+	rc=1
+    else
+	echo "check: $1 $2, within $3"
+    fi
+}
+
+budget size "`size $exe | awk 'NR==2 { print $4 }'`" $3
+budget libs "`ldd $exe | wc -l`" $4
+budget startup "`env -u DISPLAY $bench $exe 20 | awk '
+    /failed/ { failed = 1 }
+    !/^#/ && NF == 5 && $4 > m { m = $4 }
+    END { if (!failed) print m }'`" $5
+exit $rc
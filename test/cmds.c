@@ -0,0 +1,128 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+// Checks MatchCommand against a linear search of cmds.txt, over every
+// command in several cases, their prefixes and extensions, and random
+// tokens. Then times both, to show what the hashed dispatch saves.
+
+#include "../command.h"
+#include <ctype.h>
+#include <inttypes.h>
+#include <time.h>
+
+//----------------------------------------------------------------------
+
+static const char* c_Names [cmd_NCMDS] = {
+    #define CMD(name,slot)	#name,
+    #include "../cmds.h"
+    #undef CMD
+};
+
+static unsigned _failures = 0;
+
+//----------------------------------------------------------------------
+
+static enum ECmd LinearMatch (strblk_t t);
+static void Check (const char* s, size_t n);
+static void CheckCases (const char* name);
+static uint64_t NowNsec (void);
+static void Benchmark (void);
+
+//----------------------------------------------------------------------
+
+int main (void)
+{
+    for (unsigned i = 0; i < cmd_NCMDS; ++i)
+	CheckCases (c_Names[i]);
+    // Random tokens, mostly from the letters of the commands
+    static const char c_Chars[] = "ABCDEFGILMNOPQRSTUYabdeginoprstuy_ #%";
+    uint32_t seed = 1;
+    char tok [CMD_MAXLEN+2];
+    for (unsigned i = 0; i < 1000000; ++i) {
+	const size_t n = 1 + i % (sizeof(tok)-1);
+	for (size_t j = 0; j < n; ++j) {
+	    seed = seed * 1103515245 + 12345;
+	    tok[j] = c_Chars [(seed >> 16) % (sizeof(c_Chars)-1)];
+	}
+	Check (tok, n);
+    }
+    if (_failures) {
+	printf ("cmds: %u failures\n", _failures);
+	return EXIT_FAILURE;
+    }
+    printf ("cmds: %u commands ok\n", cmd_NCMDS);
+    Benchmark();
+    return EXIT_SUCCESS;
+}
+
+static enum ECmd LinearMatch (strblk_t t)
+{
+    for (unsigned i = 0; i < cmd_NCMDS; ++i)
+	if (t.n == strlen (c_Names[i]) && 0 == strncasecmp (c_Names[i], t.p, t.n))
+	    return i;
+    return cmd_NCMDS;
+}
+
+static void Check (const char* s, size_t n)
+{
+    const strblk_t t = { s, n };
+    const enum ECmd got = MatchCommand (t), want = LinearMatch (t);
+    if (got != want && ++_failures <= 10)
+	printf ("cmds: %.*s matched %u instead of %u\n", (int) n, s, got, want);
+}
+
+static void CheckCases (const char* name)
+{
+    char s [CMD_MAXLEN+8];
+    const size_t n = strlen (name);
+    strcpy (s, name);
+    Check (s, n);
+    for (size_t i = 0; i < n; ++i)	// Lowercase, then mixed case
+	s[i] = tolower (s[i]);
+    Check (s, n);
+    for (size_t i = 0; i < n; i += 2)
+	s[i] = toupper (s[i]);
+    Check (s, n);
+    // Prefixes and extensions only match if they are other commands
+    for (size_t i = 1; i < n; ++i)
+	Check (name, i);
+    static const char* c_Suffixes[] = { "X", "S", "_TT", "_TTX", "ERROR" };
+    for (unsigned i = 0; i < sizeof(c_Suffixes)/sizeof(c_Suffixes[0]); ++i) {
+	snprintf (s, sizeof(s), "%s%s", name, c_Suffixes[i]);
+	Check (s, strlen(s));
+    }
+}
+
+static uint64_t NowNsec (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+static void Benchmark (void)
+{
+    // A gpg-agent session: options, then descriptions, then the dialog
+    static const char* c_Mix[] = {
+	"OPTION", "OPTION", "OPTION", "OPTION", "OPTION", "GETINFO",
+	"SETKEYINFO", "SETDESC", "SETPROMPT", "SETQUALITYBAR", "SETQUALITYBAR_TT",
+	"GETPIN", "BYE", "setrepeaterror", "NOSUCHCOMMAND"
+    };
+    enum { NMIX = sizeof(c_Mix)/sizeof(c_Mix[0]), NITER = 200000 };
+    strblk_t mix [NMIX];
+    for (unsigned i = 0; i < NMIX; ++i)
+	mix[i] = (strblk_t) { c_Mix[i], strlen(c_Mix[i]) };
+    enum ECmd (*const c_Matchers[2])(strblk_t) = { MatchCommand, LinearMatch };
+    static const char c_MatcherNames[2][8] = { "hash", "linear" };
+    for (unsigned m = 0; m < 2; ++m) {
+	volatile unsigned sink = 0;
+	const uint64_t start = NowNsec();
+	for (unsigned i = 0; i < NITER; ++i)
+	    for (unsigned j = 0; j < NMIX; ++j)
+		sink += c_Matchers[m] (mix[j]);
+	const uint64_t nsec = NowNsec() - start;
+	printf ("cmds: %-6s %.1f ns per command\n", c_MatcherNames[m], (double) nsec / (NITER*NMIX));
+    }
+}
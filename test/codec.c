@@ -0,0 +1,172 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+// Checks that percent escaping round trips: known strings, empty input,
+// escapes at the line limit, and random data heavy in '%', CR, and LF,
+// escaped in D line sized pieces as ReplyData does. With "bench" as the
+// argument, also prints the throughput of each direction.
+
+#include "../codec.h"
+#include <inttypes.h>
+#include <time.h>
+
+//----------------------------------------------------------------------
+
+enum {
+    LINE_DATA = ASSUAN_LINE_LIMIT-2,	// Escaped bytes per D line
+    MAX_DATA = 4*ASSUAN_LINE_LIMIT,
+    BENCH_SIZE = 1<<20,
+    BENCH_RUNS = 20
+};
+
+static unsigned _failures = 0;
+
+//----------------------------------------------------------------------
+
+static void Fail (const char* what, const char* s, size_t n);
+static void CheckEscape (const char* s, size_t n, const char* want);
+static void CheckUnescape (const char* s, const char* want, size_t wantn);
+static void CheckRoundTrip (const char* s, size_t n);
+static size_t EscapeLines (char* d, const char* s, size_t n);
+static uint64_t NowNsec (void);
+static void Benchmark (void);
+
+//----------------------------------------------------------------------
+
+int main (int argc, char* argv[])
+{
+    CheckEscape ("", 0, "");
+    CheckEscape ("plain text", 10, "plain text");
+    CheckEscape ("50%\r\n", 5, "50%25%0D%0A");
+    CheckEscape ("\0\x1f\x7f\x80\xff", 5, "%00%1F%7F%80%FF");
+    CheckUnescape ("", "", 0);
+    CheckUnescape ("50%25%0D%0a", "50%\r\n", 5);
+    CheckUnescape ("%00x", "\0x", 2);
+    // Invalid and cut off escapes are kept as they are
+    CheckUnescape ("%G1%4", "%G1%4", 5);
+    CheckUnescape ("100%", "100%", 4);
+
+    // An escape that does not fit at the end of a line moves to the next
+    static char s_Data [MAX_DATA];
+    for (size_t pad = LINE_DATA-3; pad <= LINE_DATA; ++pad) {
+	memset (s_Data, 'a', pad);
+	s_Data[pad] = '%';
+	s_Data[pad+1] = '\n';
+	CheckRoundTrip (s_Data, pad+2);
+    }
+    // Random data, a quarter of it bytes that are escaped
+    static const char c_Escaped[] = "%\r\n\0\x7f\xff";
+    uint32_t seed = 1;
+    for (unsigned i = 0; i < 2000; ++i) {
+	const size_t n = i % MAX_DATA;
+	for (size_t j = 0; j < n; ++j) {
+	    seed = seed * 1103515245 + 12345;
+	    const unsigned r = seed >> 16;
+	    s_Data[j] = r % 4 ? (char) (' ' + r/4 % 95) : c_Escaped [r/4 % (sizeof(c_Escaped)-1)];
+	}
+	CheckRoundTrip (s_Data, n);
+    }
+    if (_failures) {
+	printf ("codec: %u failures\n", _failures);
+	return EXIT_FAILURE;
+    }
+    puts ("codec: round trips ok");
+    if (argc > 1 && 0 == strcmp (argv[1], "bench"))
+	Benchmark();
+    return EXIT_SUCCESS;
+}
+
+static void Fail (const char* what, const char* s, size_t n)
+{
+    if (++_failures <= 10)
+	printf ("codec: %s of %zu bytes \"%.*s\"\n", what, n, (int) (n < 40 ? n : 40), s);
+}
+
+static void CheckEscape (const char* s, size_t n, const char* want)
+{
+    char d [64];
+    size_t used;
+    const size_t dn = PercentEscape (d, sizeof(d), s, n, &used);
+    if (used != n || dn != strlen (want) || 0 != memcmp (d, want, dn))
+	Fail ("escape", s, n);
+}
+
+static void CheckUnescape (const char* s, const char* want, size_t wantn)
+{
+    char d [64];
+    const size_t dn = PercentUnescape (d, s, strlen(s));
+    if (dn != wantn || d[dn] || 0 != memcmp (d, want, dn))
+	Fail ("unescape", s, strlen(s));
+    // In place, as for command arguments
+    char inplace [64];
+    strcpy (inplace, s);
+    if (dn != PercentUnescape (inplace, inplace, strlen(s)) || 0 != memcmp (inplace, want, dn))
+	Fail ("unescape in place", s, strlen(s));
+}
+
+static void CheckRoundTrip (const char* s, size_t n)
+{
+    // Each line must unescape on its own, so joined they give s back
+    static char s_Escaped [3*MAX_DATA], s_Back [3*MAX_DATA];
+    const size_t en = EscapeLines (s_Escaped, s, n);
+    size_t bn = 0;
+    for (size_t i = 0, ll; i < en; i += ll+1) {
+	ll = strcspn (&s_Escaped[i], "\n");
+	if (ll > LINE_DATA)
+	    Fail ("line too long", s, n);
+	bn += PercentUnescape (&s_Back[bn], &s_Escaped[i], ll);
+    }
+    // Empty data is still one line
+    if (bn != n || 0 != memcmp (s_Back, s, n) || (!n && en != 1))
+	Fail ("round trip", s, n);
+}
+
+// Escapes s as ReplyData does, into lines ending with '\n',
+// without the "D " prefix. Returns the escaped length.
+static size_t EscapeLines (char* d, const char* s, size_t n)
+{
+    size_t dn = 0;
+    do {
+	size_t used;
+	dn += PercentEscape (&d[dn], LINE_DATA, s, n, &used);
+	d[dn++] = '\n';
+	s += used;
+	n -= used;
+    } while (n);
+    return dn;
+}
+
+static uint64_t NowNsec (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+static void Benchmark (void)
+{
+    // Description-like text: mostly printable, a few escapes per line
+    static char s_Text [BENCH_SIZE], s_Escaped [3*BENCH_SIZE], s_Back [3*BENCH_SIZE];
+    static const char c_Line[] = "Please enter the passphrase to unlock the key for 100% of\n\"Alice <alice@example.org>\"\r\n";
+    for (size_t i = 0; i < BENCH_SIZE; ++i)
+	s_Text[i] = c_Line [i % (sizeof(c_Line)-1)];
+    uint64_t escapeBest = UINT64_MAX, unescapeBest = UINT64_MAX;
+    size_t en = 0;
+    for (unsigned r = 0; r < BENCH_RUNS; ++r) {
+	uint64_t start = NowNsec();
+	en = EscapeLines (s_Escaped, s_Text, BENCH_SIZE);
+	uint64_t t = NowNsec() - start;
+	if (t < escapeBest)
+	    escapeBest = t;
+	start = NowNsec();
+	PercentUnescape (s_Back, s_Escaped, en);
+	t = NowNsec() - start;
+	if (t < unescapeBest)
+	    unescapeBest = t;
+    }
+    // MB/s of unescaped data; the line ends unescape to themselves
+    printf ("codec: escape   %7.1f MB/s\n", BENCH_SIZE * 1e3 / (escapeBest ? escapeBest : 1));
+    printf ("codec: unescape %7.1f MB/s\n", BENCH_SIZE * 1e3 / (unescapeBest ? unescapeBest : 1));
+}
@@ -0,0 +1,52 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+// Counts heap allocations, when preloaded with LD_PRELOAD. The count
+// is written at exit to the file named by MALLOCOUNT, or to stderr.
+
+#include "../config.h"
+#include <fcntl.h>
+
+//----------------------------------------------------------------------
+
+// The glibc allocator under the interposed names
+extern void* __libc_malloc (size_t n);
+extern void* __libc_calloc (size_t n, size_t sz);
+extern void* __libc_realloc (void* p, size_t n);
+
+static unsigned _mallocs = 0;
+
+//----------------------------------------------------------------------
+
+void* malloc (size_t n)
+{
+    ++_mallocs;
+    return __libc_malloc (n);
+}
+
+void* calloc (size_t n, size_t sz)
+{
+    ++_mallocs;
+    return __libc_calloc (n, sz);
+}
+
+void* realloc (void* p, size_t n)
+{
+    ++_mallocs;
+    return __libc_realloc (p, n);
+}
+
+__attribute__((destructor)) static void WriteCount (void)
+{
+    const char* fname = getenv ("MALLOCOUNT");
+    int fd = fname ? open (fname, O_WRONLY| O_CREAT| O_TRUNC| O_CLOEXEC, 0600) : STDERR_FILENO;
+    if (fd < 0)
+	return;
+    char line [32];
+    int linelen = snprintf (line, sizeof(line), "%u\n", _mallocs);
+    UNUSED ssize_t bw = write (fd, line, linelen);
+    if (fd != STDERR_FILENO)
+	close (fd);
+}
@@ -0,0 +1,46 @@
+#! /bin/sh
+#
+# This file is part of the pinentry-xlib project
+#
+# Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+# This file is free software, distributed under the MIT License.
+#
+# Checks that an Assuan session makes no heap allocations in steady
+# state: repeating its commands a hundred times must allocate as much
+# as running them once, with no command failing on the way.
+# Usage: mallocs.sh PINENTRY MALLOCOUNT_SO
+
+exe=$1
+preload=$2
+countfile=`mktemp` || exit 1
+replyfile=`mktemp` || exit 1
+trap 'rm -f $countfile $replyfile' EXIT
+
+round='SETDESC Please enter the passphrase for%0A%22Alice Example <alice@example.org>%22
+OPTION display=:0
+OPTION allow-external-password-cache
+SETKEYINFO n/8D5A3E0F6B9C2D41E7F03A5B6C8D9E0F1A2B3C4D
+SETPROMPT Passphrase:
+SETERROR Bad passphrase (try 2 of 3)
+SETMULTI First key
+SETMULTI Second key
+GETPINS
+GETPIN
+GETINFO pid
+GETINFO stats
+'
+
+mallocs() {
+    i=0
+    while [ $i -lt $1 ]; do
+	printf '%s' "$round"
+	i=$((i+1))
+    done | MALLOCOUNT=$countfile LD_PRELOAD=$preload PINENTRY_XLIB_SCRIPT='first\rsecond\r' $exe --no-forward > $replyfile
+    cat $countfile
+}
+
+once=`mallocs 1`
+many=`mallocs 100`
+errors=`grep -c '^ERR' $replyfile`
+echo "mallocs: $once for 1 round, $many for 100, $errors errors"
+[ -n "$once" ] && [ "$once" = "$many" ] && [ "$errors" -eq 0 ]
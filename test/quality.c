@@ -0,0 +1,86 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+// Per-key cost of the quality estimator. Each password is typed into
+// QualityUpdate one key at a time, as OnKey does, a hundred times. The
+// score, the mean time per key, and the slowest key are printed; each
+// key's time is the fastest of its repeats, to leave out preemption.
+// Fails if a key takes over a millisecond. Passwords may be given on
+// the command line.
+
+#include "../quality.h"
+#include "../xdlg.h"
+#include "../secmem.h"
+#include <inttypes.h>
+#include <time.h>
+
+//----------------------------------------------------------------------
+
+enum { NREPEATS = 100, MAX_KEY_NSEC = 1000000 };
+
+//----------------------------------------------------------------------
+
+static uint64_t NowNsec (void);
+static bool TimeTyping (const char* pw);
+
+//----------------------------------------------------------------------
+
+int main (int argc, char* argv[])
+{
+    static const char* c_Passwords[] = {
+	"password", "Password1234", "qwertyuiop", "1q2w3e4r5t", "aaaaaaaaaaaa",
+	"abcdefghijkl", "14/07/1989", "correcthorsebatterystaple", "p4$$w0rd!",
+	"Tr0ub4dor&3", "kx9#Vq2!mZr7@Lw", "the quick brown fox jumps over the lazy dog",
+	"zzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzz"
+    };
+    if (!SecmemInit()) {
+	fputs ("quality: unable to allocate secure memory\n", stderr);
+	return EXIT_FAILURE;
+    }
+    bool ok = true;
+    if (argc > 1)
+	for (int i = 1; i < argc; ++i)
+	    ok &= TimeTyping (argv[i]);
+    else
+	for (unsigned i = 0; i < sizeof(c_Passwords)/sizeof(c_Passwords[0]); ++i)
+	    ok &= TimeTyping (c_Passwords[i]);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static uint64_t NowNsec (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+static bool TimeTyping (const char* pw)
+{
+    const size_t n = strnlen (pw, PASSWORD_MAXLEN-1);
+    if (!n)
+	return true;
+    uint64_t total = 0, fastest [PASSWORD_MAXLEN];
+    memset (fastest, 0xff, sizeof(fastest));
+    for (unsigned r = 0; r < NREPEATS; ++r) {
+	for (size_t k = 1; k <= n; ++k) {
+	    const uint64_t start = NowNsec();
+	    QualityUpdate (pw, k);
+	    const uint64_t t = NowNsec() - start;
+	    total += t;
+	    if (t < fastest[k-1])
+		fastest[k-1] = t;
+	}
+	QualityUpdate (pw, 0);
+    }
+    uint64_t worst = 0;
+    for (size_t k = 0; k < n; ++k)
+	if (fastest[k] > worst)
+	    worst = fastest[k];
+    QualityUpdate (pw, n);
+    printf ("quality: %-26.26s %3u bits %8.2f us/key %8.2f us slowest\n", pw, QualityBits(),
+	    total / 1e3 / (NREPEATS*n), worst / 1e3);
+    QualityUpdate (pw, 0);
+    return worst < MAX_KEY_NSEC;
+}
@@ -0,0 +1,205 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+// Transcript replay benchmark. Pipes a recorded Assuan transcript into
+// pinentry-xlib repeatedly, with dialogs answered by a keystroke script
+// instead of a display, and prints sessions per second and the latency
+// of each command, with a power of two microsecond histogram.
+
+#include "../config.h"
+#include <sys/wait.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <time.h>
+
+//----------------------------------------------------------------------
+
+enum { MAX_CMDS = 32, MAX_SAMPLES = 1<<16, NBUCKETS = 16 };
+
+typedef struct {
+    char	name [24];
+    unsigned	n;
+    uint32_t	usec [MAX_SAMPLES];
+} cmdtimes_t;
+
+static cmdtimes_t _cmds [MAX_CMDS];
+static unsigned _ncmds = 0;
+
+//----------------------------------------------------------------------
+
+static uint64_t NowUsec (void);
+static char* LoadFile (const char* filename, size_t* len);
+static bool RunSession (const char* exe, const char* transcript, size_t len, unsigned* errors);
+static void ReadTrace (const char* tracefile);
+static int CompareUsec (const void* a, const void* b);
+static void PrintCommand (cmdtimes_t* c);
+
+//----------------------------------------------------------------------
+
+int main (int argc, char* argv[])
+{
+    if (argc < 3) {
+	fputs ("Usage: replay PINENTRY TRANSCRIPT [SESSIONS]\n", stderr);
+	return EXIT_FAILURE;
+    }
+    const char* exe = argv[1];
+    size_t len;
+    char* transcript = LoadFile (argv[2], &len);
+    if (!transcript) {
+	perror (argv[2]);
+	return EXIT_FAILURE;
+    }
+    const unsigned sessions = argc > 3 ? strtoul (argv[3], NULL, 0) : 1000;
+    char tracefile[] = "/tmp/pinentry-replay.XXXXXX";
+    int tfd = mkstemp (tracefile);
+    if (tfd < 0) {
+	perror ("mkstemp");
+	return EXIT_FAILURE;
+    }
+    close (tfd);
+    // Dialogs are answered by the headless backend. With a quality
+    // bar, the passphrase is typed twice, as for a new one.
+    setenv ("PINENTRY_XLIB_TRACE", tracefile, true);
+    setenv ("PINENTRY_XLIB_SCRIPT", "replayed passphrase\\rreplayed passphrase\\r", false);
+
+    unsigned failed = 0, errors = 0;
+    const uint64_t start = NowUsec();
+    for (unsigned i = 0; i < sessions; ++i)
+	if (!RunSession (exe, transcript, len, &errors))
+	    ++failed;
+    const uint64_t elapsed = NowUsec() - start;
+    ReadTrace (tracefile);
+    unlink (tracefile);
+    free (transcript);
+
+    printf ("# %s, %u sessions\n", argv[2], sessions);
+    printf ("sessions/s %.0f\n", sessions * 1e6 / (elapsed ? elapsed : 1));
+    printf ("errors %u\nfailed %u\n", errors, failed);
+    printf ("# %-17s%7s%8s%8s%8s%8s  log2 usec histogram\n", "command", "n", "min", "median", "p99", "max");
+    for (unsigned i = 0; i < _ncmds; ++i)
+	PrintCommand (&_cmds[i]);
+    return failed || errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static uint64_t NowUsec (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*UINT64_C(1000000) + ts.tv_nsec/1000;
+}
+
+static char* LoadFile (const char* filename, size_t* len)
+{
+    FILE* f = fopen (filename, "r");
+    if (!f)
+	return NULL;
+    char* s = NULL;
+    long n;
+    if (0 == fseek (f, 0, SEEK_END) && 0 < (n = ftell (f)) && (s = malloc (n))) {
+	*len = n;
+	rewind (f);
+	if (*len != fread (s, 1, *len, f)) {
+	    free (s);
+	    s = NULL;
+	}
+    }
+    fclose (f);
+    return s;
+}
+
+// Runs one session, counting ERR replies, which fail the replay
+// like sessions that do not finish. Returns false if the session did not end with BYE.
+static bool RunSession (const char* exe, const char* transcript, size_t len, unsigned* errors)
+{
+    int inpipe[2], outpipe[2];
+    if (0 != pipe2 (inpipe, O_CLOEXEC))
+	return false;
+    if (0 != pipe2 (outpipe, O_CLOEXEC)) {
+	close (inpipe[0]);
+	close (inpipe[1]);
+	return false;
+    }
+    pid_t pid = fork();
+    if (!pid) {
+	dup2 (inpipe[0], STDIN_FILENO);
+	dup2 (outpipe[1], STDOUT_FILENO);
+	execl (exe, exe, "--no-forward", NULL);
+	_exit (EXIT_FAILURE);
+    }
+    close (inpipe[0]);
+    close (outpipe[1]);
+    // Replies are only read after the whole transcript is written,
+    // which is fine while they fit in the pipe buffer.
+    UNUSED ssize_t bw = write (inpipe[1], transcript, len);
+    close (inpipe[1]);
+    bool closed = false;
+    FILE* f = fdopen (outpipe[0], "r");
+    for (char line [ASSUAN_LINE_LIMIT+2]; f && fgets (line, sizeof(line), f);) {
+	*errors += 0 == strncmp (line, "ERR", 3);
+	closed = 0 == strcmp (line, "OK closing connection\n");
+    }
+    if (f)
+	fclose (f);
+    else
+	close (outpipe[0]);
+    int status = 0;
+    if (pid < 0 || 0 > waitpid (pid, &status, 0) || !WIFEXITED(status) || WEXITSTATUS(status))
+	return false;
+    return closed;
+}
+
+static void ReadTrace (const char* tracefile)
+{
+    FILE* f = fopen (tracefile, "r");
+    if (!f)
+	return;
+    char name [sizeof(_cmds[0].name)];
+    uint64_t mono, usec;
+    for (char line [128]; fgets (line, sizeof(line), f);) {
+	if (3 != sscanf (line, "cmd %23s %" SCNu64 " %" SCNu64, name, &mono, &usec))
+	    continue;
+	for (char* c = name; *c; ++c)
+	    *c = toupper (*c);
+	unsigned i = 0;
+	while (i < _ncmds && 0 != strcmp (_cmds[i].name, name))
+	    ++i;
+	if (i == _ncmds) {
+	    if (_ncmds >= MAX_CMDS)
+		continue;
+	    strcpy (_cmds[_ncmds++].name, name);
+	}
+	if (_cmds[i].n < MAX_SAMPLES)
+	    _cmds[i].usec[_cmds[i].n++] = usec;
+    }
+    fclose (f);
+}
+
+static int CompareUsec (const void* a, const void* b)
+{
+    const uint32_t ua = *(const uint32_t*) a, ub = *(const uint32_t*) b;
+    return (ua > ub) - (ua < ub);
+}
+
+static void PrintCommand (cmdtimes_t* c)
+{
+    const unsigned n = c->n;
+    qsort (c->usec, n, sizeof(c->usec[0]), CompareUsec);
+    // Bucket i holds times below 2^i usec
+    unsigned hist [NBUCKETS] = {0}, maxbucket = 0;
+    for (unsigned i = 0; i < n; ++i) {
+	unsigned b = 0;
+	while (b < NBUCKETS-1 && c->usec[i] >= 1u<<b)
+	    ++b;
+	++hist[b];
+	if (b > maxbucket)
+	    maxbucket = b;
+    }
+    printf ("  %-17s%7u%8u%8u%8u%8u ", c->name, n, c->usec[0], c->usec[(n-1)/2], c->usec[(99*n+99)/100-1], c->usec[n-1]);
+    for (unsigned b = 0; b <= maxbucket; ++b)
+	printf (" %u", hist[b]);
+    putchar ('\n');
+}
@@ -0,0 +1,25 @@
+#! /bin/sh
+#
+# This file is part of the pinentry-xlib project
+#
+# Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+# This file is free software, distributed under the MIT License.
+#
+# Runs a long passphrase retry loop in one session, as gpg-agent does
+# after wrong passphrases. Each round sets a new error text and a long
+# description, so freed session strings must be reused for the arena
+# to last. Fails on any ERR reply. Usage: retries.sh PINENTRY
+
+exe=$1
+rounds=300
+desc=`printf '%700s' '' | tr ' ' x`
+
+i=0
+replies=`while [ $i -lt $rounds ]; do
+    printf 'SETERROR Bad passphrase (try %d)\nSETDESC %s\nSETPROMPT Passphrase:\nGETPIN\n' $i "$desc"
+    i=$((i+1))
+done | PINENTRY_XLIB_SCRIPT='retried\r' $exe --no-forward`
+errors=`echo "$replies" | grep -c '^ERR'`
+passphrases=`echo "$replies" | grep -c '^D retried$'`
+echo "retries: $passphrases of $rounds rounds, $errors errors"
+[ "$errors" -eq 0 ] && [ "$passphrases" -eq $rounds ]
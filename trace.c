@@ -0,0 +1,92 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#include "trace.h"
+#include "stats.h"
+#include <fcntl.h>
+#include <inttypes.h>
+#include <time.h>
+
+//----------------------------------------------------------------------
+
+uint64_t NowUsec (void)
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec*UINT64_C(1000000) + ts.tv_nsec/1000;
+}
+
+// Trace lines are appended to the file named by PINENTRY_XLIB_TRACE.
+// Returns -1 when tracing is disabled.
+static int TraceFd (uint64_t* exec)
+{
+    static int s_fd = -2;	// -2 is not yet checked, -1 is disabled
+    static uint64_t s_exec = 0;
+    if (s_fd == -2) {
+	const char* fname = getenv ("PINENTRY_XLIB_TRACE");
+	s_fd = fname ? open (fname, O_WRONLY| O_CREAT| O_APPEND| O_CLOEXEC, 0600) : -1;
+	s_exec = NowUsec();
+    }
+    if (exec)
+	*exec = s_exec;
+    return s_fd;
+}
+
+// Phase timestamps are written, one per line, as
+// "phase monotonic_usec usec_since_exec".
+// The absolute time lets the benchmark measure from its own fork.
+void TracePhase (ephase_t phase)
+{
+    StatsPhase (phase);
+    uint64_t exec;
+    const int fd = TraceFd (&exec);
+    if (fd < 0)
+	return;
+    static const char c_PhaseNames [phase_NPhases][12] = {	// Parallel to ephase_t
+	"exec",
+	"dialog",
+	"connected",
+	"mapped",
+	"drawn",
+	"grabbed"
+    };
+    const uint64_t now = NowUsec();
+    char line [64];
+    int linelen = snprintf (line, sizeof(line), "%s %" PRIu64 " %" PRIu64 "\n", c_PhaseNames[phase], now, now-exec);
+    UNUSED ssize_t bw = write (fd, line, linelen);
+}
+
+uint64_t TraceStart (void)
+{
+    return TraceFd (NULL) < 0 ? 0 : NowUsec();
+}
+
+// Command timings are written as "cmd NAME monotonic_usec usec_taken",
+// so replaying a recorded transcript gives the latency of each command.
+void TraceCommand (const char* name, size_t namelen, uint64_t start)
+{
+    if (!start)
+	return;
+    const uint64_t now = NowUsec();
+    if (namelen > 20)
+	namelen = 20;	// Longest is SETQUALITYBAR_TT; the rest are unknown commands
+    char line [80];
+    int linelen = snprintf (line, sizeof(line), "cmd %.*s %" PRIu64 " %" PRIu64 "\n", (int) namelen, name, now, now-start);
+    UNUSED ssize_t bw = write (TraceFd (NULL), line, linelen);
+}
+
+// Key timings are written as "key monotonic_usec usec_to_visible
+// server_time_ms framekeys". The server time is that of the key event,
+// to match it with injected keys, and framekeys is the number of keys
+// drawn in the same frame, showing how far drawing fell behind.
+void TraceKey (uint64_t start, unsigned long servertime, unsigned framekeys)
+{
+    if (!start)
+	return;
+    const uint64_t now = NowUsec();
+    char line [80];
+    int linelen = snprintf (line, sizeof(line), "key %" PRIu64 " %" PRIu64 " %lu %u\n", now, now-start, servertime, framekeys);
+    UNUSED ssize_t bw = write (TraceFd (NULL), line, linelen);
+}
@@ -0,0 +1,31 @@
+// This file is part of the pinentry-xlib project
+//
+// Copyright (c) 2014 by Mike Sharov <msharov@users.sourceforge.net>
+// This file is free software, distributed under the MIT License.
+
+#pragma once
+#include "config.h"
+#include <stdint.h>
+
+//----------------------------------------------------------------------
+
+// Timestamped points on the way to an interactive dialog
+typedef enum {
+    phase_Exec,		// main entered
+    phase_Dialog,	// dialog requested
+    phase_Connected,	// X display opened
+    phase_Mapped,	// MapNotify received
+    phase_Drawn,	// first DrawWindow after Expose
+    phase_Grabbed,	// keyboard grab acquired
+    phase_NPhases
+} ephase_t;
+
+//----------------------------------------------------------------------
+
+uint64_t NowUsec (void);
+void TracePhase (ephase_t phase);
+
+// Returns the start time for TraceCommand and TraceKey, or 0 when tracing is disabled
+uint64_t TraceStart (void);
+void TraceCommand (const char* name, size_t namelen, uint64_t start);
+void TraceKey (uint64_t start, unsigned long servertime, unsigned framekeys);
@@ -4,33 +4,33 @@
 // This file is free software, distributed under the MIT License.
 
 #include "xdlg.h"
+#include "trace.h"
+#include "stats.h"
+#include "assuan.h"
+#include "font.h"
 #if !__has_include(<X11/Xlib.h>) || !__has_include(<X11/Xutil.h>)
     #error "X11 development headers are required to compile pinentry"
 #endif
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
-#include <signal.h>
+#include <sys/timerfd.h>
+#include <poll.h>
+#include <errno.h>
+#include <ctype.h>
+#include <pthread.h>
 #if __has_include(<X11/extensions/Xdbe.h>)
     #include <X11/extensions/Xdbe.h>
 #endif
-
-//----------------------------------------------------------------------
-// Extern interface set from main
-
-int _argc = 0;
-const char* const* _argv = NULL;
-char* _displayName = NULL;
-
-edlgtype_t _dialogType = PromptForPassword;
-char* _description = NULL;
-char _prompt [PROMPT_MAXLEN] = DEFAULT_PASSWORD_PROMPT;
-unsigned _confirms = 0;
-unsigned _parentWindow = 0;
-unsigned _entryTimeout = 0;
-bool _nograb = false;
-
-char _password [PASSWORD_MAXLEN] = "";
-size_t _passwordLen = 0;
+#if __has_include(<X11/extensions/XShm.h>)
+    #include <X11/extensions/XShm.h>
+    #include <sys/shm.h>
+#endif
+#if HAVE_XCB
+    #include <X11/Xlib-xcb.h>
+#endif
+#if HAVE_XFT
+    #include <X11/Xft/Xft.h>
+#endif
 
 //----------------------------------------------------------------------
 // Module internal variables
@@ -39,6 +39,22 @@ size_t _passwordLen = 0;
 static Display* _display = NULL;
 static int _screen = 0;
 static bool _isGrabbed = false;
+static int _timerfd = -1;	// Entry timeout
+static uint64_t _serverGrabStart = 0;	// When XGrabServer was sent, 0 if not grabbed
+static unsigned _roundTrips = 0;	// Not yet added to _stats, which the prewarm thread does not touch
+static bool _inXDialog = false;		// X errors outside a dialog have no command to reply to
+static char _pendingXError [ASSUAN_LINE_LIMIT] = "";	// The first of them, reported by the next dialog
+
+// The display can be opened and the window created on a separate thread
+// while the protocol is handled. The main thread makes no X calls until
+// it joins the thread.
+static pthread_t _prewarmThread;
+static bool _prewarmRunning = false;
+static _Atomic bool _inPrewarm = false;	// Set on the prewarm thread while it runs
+static _Atomic bool _prewarmFailed = false;
+static _Atomic bool _prewarmLost = false;	// The connection broke; reported after the join
+static char _prewarmDisplay [256];	// Copied, since OPTION display can replace _displayName
+static uint64_t _prewarmConnectUsec = 0;
 
 enum {
     a_ATOM,
@@ -58,18 +74,98 @@ enum {
     a_NAtoms
 };
 static Atom _atoms [a_NAtoms] = { None };
+//{{{ c_AtomNames - parallel to enum
+static const char* c_AtomNames [a_NAtoms] = {
+    "ATOM",
+    "STRING",
+    "CARDINAL",
+    "WM_CLIENT_MACHINE",
+    "WM_PROTOCOLS",
+    "WM_DELETE_WINDOW",
+    "_NET_WM_PID",
+    "_NET_WM_STATE",
+    "_NET_WM_STATE_NORMAL",
+    "_NET_WM_STATE_MODAL",
+    "_NET_WM_STATE_DEMANDS_ATTENTION",
+    "_NET_WM_STATE_ABOVE",
+    "_NET_WM_WINDOW_TYPE",
+    "_NET_WM_WINDOW_TYPE_DIALOG"
+};
+//}}}
+
+// Resources, read from the RESOURCE_MANAGER string Xlib fetched with the display
+enum {
+    res_foreground,
+    res_background,
+    res_font,
+    res_faceName,
+    res_shm,
+    res_N
+};
+enum { RESOURCE_MAXLEN = 128 };
+static struct {
+    char	v [res_N][RESOURCE_MAXLEN];	// Empty if not set
+    uint8_t	prec [res_N];	// How closely the key matched, so *font does not override pinentry-xlib.font
+} _res;
+//{{{ c_ResourceNames - parallel to enum
+static const char* c_ResourceNames [res_N] = {
+    "foreground",
+    "background",
+    "font",
+    "faceName",
+    "shm"
+};
+//}}}
 
 // Pinentry window
-static Window _w = None;
+static Window _w = None;		// Kept, unmapped, between dialogs
+static Window _wparent = None;		// The transient for hint last set
 static GC _gc = None;
-static XFontStruct* _font = NULL;
-static XFontStruct* _wfontinfo = NULL;
+static XFontStruct* _font = NULL;	// A core font, if the font resource names one
+static Pixmap _fontAtlas = None;	// The built-in font glyphs, used when there is no other font
 static unsigned long _fg = 0, _bg = 0;
+#if HAVE_XFT
+    static XftFont* _xftfont = NULL;	// Used instead of _font when RENDER is available
+    static XftDraw* _xftdraw = NULL;
+    static XftColor _xftfg;
+#endif
 static unsigned _wwidth = 0;
 static unsigned _wheight = 0;
 #if __has_include(<X11/extensions/Xdbe.h>)
     static XdbeBackBuffer _d = None;
+    static bool _haveDbe = false;
 #endif
+#if __has_include(<X11/extensions/XShm.h>)
+    // With the shm resource set, frames are drawn client-side into _shmimg
+    // and only the damaged part is sent with XShmPutImage. Text is copied
+    // from an atlas of glyphs, drawn by the server once per connection.
+    enum { ATLAS_FIRST = ' ', ATLAS_N = 0x100-ATLAS_FIRST };
+    static XShmSegmentInfo _shminfo = { .shmid = -1 };
+    static XImage* _shmimg = NULL;
+    static int _shmCompletion = 0;	// ShmCompletion event type; 0 when not using MIT-SHM
+    static bool _shmBusy = false;	// The server may still be reading _shmimg
+    static bool _shmAttachFailed = false;
+    static struct {
+	uint32_t*	px;	// Glyph cells in a row, ATLAS_N*cw by ch pixels
+	unsigned	cw, ch;	// Cell size
+	unsigned	ox;	// Glyph origin in the cell
+	unsigned short	adv [ATLAS_N];
+    } _atlas;
+#endif
+static Pixmap _pix = None;		// Offscreen buffer when Xdbe is unavailable
+static Drawable _canvas = None;		// Where drawing goes; one of _d, _pix, or _w
+static XRectangle _damage = {0,0,0,0};	// Canvas area changed since the last present
+static const char* _renderPath = "none";	// Reported by GETINFO renderpath
+
+// What is currently drawn, for partial updates
+static struct {
+    unsigned	passwordLen;
+    unsigned	confirmBufLen;
+    unsigned	confirmsPass;
+    unsigned	multiIndex;
+    unsigned	quality;
+    bool	valid;
+} _drawn;
 
 typedef struct {
     unsigned x, y;
@@ -86,134 +182,577 @@ static struct {
     point_t	confirmbox;
     unsigned	promptw;
     unsigned	confirmpromptw;
+    unsigned	multiline [MULTI_MAX];	// Description line before each box line
+    unsigned	multiboxy [MULTI_MAX];
 } _wl;
 
 // Entry runtime information
 enum {
-    MAX_QUALITY = 128,
     MAX_BOXES_POW = 4,
     MAX_BOXES = 1<<MAX_BOXES_POW	// The number of password char placeholder boxes visible
 };
-static char _confirmPrompt [PROMPT_MAXLEN] = "";
-static char _confirmBuf [PASSWORD_MAXLEN] = "";
-static size_t _confirmBufLen = 0;
-static unsigned _confirmsPass = 0;
-static bool _accepted = false;
 static bool _timedOut = false;
 
+// Events only request drawing; it is done once the event queue is
+// drained, so a burst of keys is drawn in one frame.
+typedef enum {
+    redraw_None,
+    redraw_Update,	// Only the entry changed
+    redraw_Full
+} eredraw_t;
+static eredraw_t _redraw = redraw_None;
+static unsigned _redrawRequests = 0;	// Events merged into the pending frame
+static struct {
+    uint64_t		start;
+    unsigned long	servertime;
+} _tracedKeys [32];			// Keys in the pending frame, when tracing
+static unsigned _nTracedKeys = 0;
+
 //----------------------------------------------------------------------
 // Module internal functions
 
-static bool OpenX (void);
-static void CloseX (void);
+static bool XOpen (void);
+static bool XRunDialog (void);
+static const char* XRenderPath (void);
+static void XPrewarm (void);
+static void* PrewarmThread (void* arg);
+static void FinishPrewarm (void);
+static bool OpenX (const char* displayName);
+#if HAVE_XCB
+static void LoadServerResourcesPipelined (const char* fgname, const char* bgname, const char* fontname);
+static XFontStruct* FontStructFromReply (xcb_font_t fid, const xcb_query_font_reply_t* r);
+#endif
+static void LoadResources (void);
+static const char* ResourceLineEnd (const char* l);
+static void LoadResourceLine (const char* l, const char* e);
+static void UnescapeResourceValue (const char* v, const char* e, char* out);
+static const char* Resource (unsigned r);
+static bool ParseColor (const char* name, XColor* c);
+static unsigned long ColorChannel (unsigned long mask, unsigned short v);
+static bool ClientSideColor (const char* name, XColor* c);
+static void CloseDisplay (void);
+static bool IsDisplayCurrent (void);
 static int OnXlibError (Display* dpy, XErrorEvent* e);
 static int OnXlibIOError (Display* dpy);
-static void OnAlarm (int sig);
+static void SetEntryTimer (unsigned secs);
+static void GrabServer (void);
+static void UngrabServer (void);
+static void CountRoundTrips (void);
 
-static void CreatePinentryWindow (void);
+static bool CreatePinentryWindow (void);
+static void ShowPinentryWindow (void);
+static void HidePinentryWindow (void);
 static void ClosePinentryWindow (void);
+static void SetSizeHints (void);
+static void SetTransientFor (void);
+static void ResizeToLayout (void);
+static void RelayoutWindow (void);
+static void SetFontUnits (void);
 static void LayoutWindow (void);
+static void LayoutText (const char* text);
+static void DrawText (const char* text, unsigned* l);
+static bool HaveXftFont (void);
+static bool HaveBuiltinFont (void);
+static unsigned FontGlyph (char c);
+static Pixmap CreateFontAtlas (void);
+static unsigned TextWidth (const char* s, size_t n);
+static void DrawString (unsigned x, unsigned y, const char* s, size_t n);
 static void DrawWindow (void);
+static void UpdateWindow (void);
+static void RequestRedraw (eredraw_t r);
+static void RedrawPending (void);
 static void DrawPasswordBoxLine (unsigned x, unsigned y, unsigned pwlen);
-static unsigned ComputeQuality (void);
-static bool OnKey (wchar_t k);
-
-#define STRBLK(s)	s,strlen(s)
+static unsigned MultiPasswordLen (unsigned i);
+static void UpdatePasswordBoxLine (unsigned x, unsigned y, unsigned oldlen, unsigned pwlen);
+static void DrawQualityBar (unsigned quality);
+static void CreateCanvas (void);
+static void ResizeCanvas (void);
+static void FreeCanvas (void);
+static void ClearCanvasArea (unsigned x, unsigned y, unsigned w, unsigned h);
+static void AddDamage (unsigned x, unsigned y, unsigned w, unsigned h);
+static void PresentCanvas (void);
+static void FillRect (unsigned x, unsigned y, unsigned w, unsigned h);
+static void StrokeRect (unsigned x, unsigned y, unsigned w, unsigned h);
+#if __has_include(<X11/extensions/XShm.h>)
+static bool IsResourceTrue (void);
+static bool BuildGlyphAtlas (void);
+static bool BuildBuiltinGlyphAtlas (void);
+static void FreeGlyphAtlas (void);
+static int OnShmAttachError (Display* dpy, XErrorEvent* e);
+static bool CreateShmImage (void);
+static void FreeShmImage (void);
+static Bool IsShmCompletion (Display* dpy, XEvent* e, XPointer arg);
+static void WaitForShm (void);
+static void ShmFillRect (unsigned x, unsigned y, unsigned w, unsigned h, unsigned long color);
+static void ShmDrawString (unsigned x, unsigned y, const char* s, size_t n);
+#endif
 
 //----------------------------------------------------------------------
 // X connection management
 
-static bool OpenX (void)
+static bool OpenX (const char* displayName)
 {
     // Open display
-    _display = XOpenDisplay (_displayName);
+    const uint64_t connectStart = NowUsec();
+    _display = XOpenDisplay (displayName);
+    _roundTrips = !!_display;	// The connection setup
+    if (_inPrewarm)
+	_prewarmConnectUsec += NowUsec() - connectStart;
+    else {
+	++_stats.connects;
+	_stats.connectUsec += NowUsec() - connectStart;
+    }
     if (!_display)
 	return false;
-    atexit (CloseX);
-    signal (SIGALRM, OnAlarm);
+    if (_timerfd < 0 && 0 > (_timerfd = timerfd_create (CLOCK_MONOTONIC, TFD_CLOEXEC))) {
+	XCloseDisplay (_display);
+	_display = NULL;
+	return false;
+    }
     XSetErrorHandler (OnXlibError);
     XSetIOErrorHandler (OnXlibIOError);
     _screen = DefaultScreen (_display);
-    // Allocate colors
-    const char* fgname = XGetDefault (_display, PINENTRY_NAME, "foreground");
-    XColor color, dbcolor;
-    if (fgname && XAllocNamedColor (_display, DefaultColormap (_display,_screen), fgname, &color, &dbcolor))
-	_fg = color.pixel;
-    else
-	_fg = WhitePixel(_display, _screen);
-    const char* bgname = XGetDefault (_display, PINENTRY_NAME, "background");
-    if (bgname && XAllocNamedColor (_display, DefaultColormap (_display,_screen), bgname, &color, &dbcolor))
-	_bg = color.pixel;
+    // Resources are already loaded by XOpenDisplay, so no round trips here
+    LoadResources();
+    const char* fgname = Resource (res_foreground);
+    const char* bgname = Resource (res_background);
+    const char* fontname = Resource (res_font);	// Without one, the built-in font needs no requests
+    _fg = WhitePixel (_display, _screen);
+    _bg = BlackPixel (_display, _screen);
+    // Colors resolved here need no allocation; the rest are left to the server
+    XColor fgcolor = { .red = 0xffff, .green = 0xffff, .blue = 0xffff }, bgcolor;
+    if (fgname && ClientSideColor (fgname, &fgcolor)) {
+	_fg = fgcolor.pixel;
+	fgname = NULL;
+    }
+    if (bgname && ClientSideColor (bgname, &bgcolor)) {
+	_bg = bgcolor.pixel;
+	bgname = NULL;
+    }
+    #if HAVE_XFT
+	// Xft uploads each glyph into the font's GlyphSet once, and the font
+	// is kept with the connection, so repaints send only glyph indices.
+	int renderEvent, renderError;
+	const char* facename = Resource (res_faceName);
+	const XRenderColor xrfg = { fgcolor.red, fgcolor.green, fgcolor.blue, 0xffff };
+	++_roundTrips;	// Xft's own requests are not counted
+	if (XRenderQueryExtension (_display, &renderEvent, &renderError)
+		&& (_xftfont = XftFontOpenName (_display, _screen, facename ? facename : DEFAULT_FACE_NAME))
+		&& !(fgname ? XftColorAllocName (_display, DefaultVisual (_display,_screen), DefaultColormap (_display,_screen), fgname, &_xftfg)
+			    : XftColorAllocValue (_display, DefaultVisual (_display,_screen), DefaultColormap (_display,_screen), &xrfg, &_xftfg))) {
+	    XftFontClose (_display, _xftfont);
+	    _xftfont = NULL;
+	}
+    #endif
+    #if HAVE_XCB
+	LoadServerResourcesPipelined (fgname, bgname, fontname);
+    #else
+	// Allocate colors; the atoms are all sent before waiting for any
+	XColor color, dbcolor;
+	_roundTrips += !!fgname + !!bgname + (fontname && !HaveXftFont()) + 1;	// The last for the atoms
+	if (fgname && XAllocNamedColor (_display, DefaultColormap (_display,_screen), fgname, &color, &dbcolor))
+	    _fg = color.pixel;
+	if (bgname && XAllocNamedColor (_display, DefaultColormap (_display,_screen), bgname, &color, &dbcolor))
+	    _bg = color.pixel;
+	// Load font, unless Xft has one
+	if (fontname && !HaveXftFont())
+	    _font = XLoadQueryFont (_display, fontname);
+	// Get Atom ids needed to create a window
+	XInternAtoms (_display, (char**) c_AtomNames, a_NAtoms, false, _atoms);
+    #endif
+    // Check if DOUBLE-BUFFER extension is available; once per connection, since it is two round trips
+    #if __has_include(<X11/extensions/Xdbe.h>)
+	int dbeMajor, dbeMinor;
+	_roundTrips += 2;
+	_haveDbe = XdbeQueryExtension (_display, &dbeMajor, &dbeMinor) && dbeMajor >= DBE_MAJOR_VERSION;
+    #endif
+    #if __has_include(<X11/extensions/XShm.h>)
+	_shmCompletion = 0;
+	if (IsResourceTrue()) {
+	    ++_roundTrips;
+	    if (XShmQueryExtension (_display))
+		_shmCompletion = XShmGetEventBase (_display) + ShmCompletion;
+	}
+    #endif
+    return true;
+}
+
+#if HAVE_XCB
+static void LoadServerResourcesPipelined (const char* fgname, const char* bgname, const char* fontname)
+{
+    // Each of these requests would be a separate round trip through Xlib.
+    // Sending them all before waiting for any replies makes it one.
+    xcb_connection_t* c = XGetXCBConnection (_display);
+    const xcb_colormap_t cmap = DefaultColormap (_display, _screen);
+    xcb_alloc_named_color_cookie_t fgck = {0}, bgck = {0};
+    if (fgname)
+	fgck = xcb_alloc_named_color (c, cmap, strlen(fgname), fgname);
+    if (bgname)
+	bgck = xcb_alloc_named_color (c, cmap, strlen(bgname), bgname);
+    const xcb_font_t fid = fontname ? xcb_generate_id (c) : 0;
+    xcb_void_cookie_t openck = {0};
+    xcb_query_font_cookie_t fontck = {0};
+    if (fontname) {
+	openck = xcb_open_font_checked (c, fid, strlen(fontname), fontname);
+	fontck = xcb_query_font (c, fid);
+    }
+    xcb_intern_atom_cookie_t atomck [a_NAtoms];
+    for (unsigned i = 0; i < a_NAtoms; ++i)
+	atomck[i] = xcb_intern_atom (c, false, strlen(c_AtomNames[i]), c_AtomNames[i]);
+
+    // Now collect the replies, in request order; all but the first are already here
+    ++_roundTrips;
+    xcb_alloc_named_color_reply_t* cr;
+    if (fgname && (cr = xcb_alloc_named_color_reply (c, fgck, NULL))) {
+	_fg = cr->pixel;
+	free (cr);
+    }
+    if (bgname && (cr = xcb_alloc_named_color_reply (c, bgck, NULL))) {
+	_bg = cr->pixel;
+	free (cr);
+    }
+    if (fontname) {
+	xcb_query_font_reply_t* fr = xcb_query_font_reply (c, fontck, NULL);
+	xcb_generic_error_t* openerr = xcb_request_check (c, openck);	// Already answered by the time fr arrives
+	if (fr && !openerr)
+	    _font = FontStructFromReply (fid, fr);
+	free (openerr);
+	free (fr);
+    }
+    for (unsigned i = 0; i < a_NAtoms; ++i) {
+	xcb_intern_atom_reply_t* ar = xcb_intern_atom_reply (c, atomck[i], NULL);
+	_atoms[i] = ar ? ar->atom : None;
+	free (ar);
+    }
+}
+
+static XCharStruct CharStructFromInfo (const xcb_charinfo_t* ci)
+{
+    return (XCharStruct) {
+	.lbearing = ci->left_side_bearing,
+	.rbearing = ci->right_side_bearing,
+	.width = ci->character_width,
+	.ascent = ci->ascent,
+	.descent = ci->descent,
+	.attributes = ci->attributes
+    };
+}
+
+static XFontStruct* FontStructFromReply (xcb_font_t fid, const xcb_query_font_reply_t* r)
+{
+    // Built in the same way as XLoadQueryFont does, so XFreeFont can release it
+    XFontStruct* f = calloc (1, sizeof(XFontStruct));
+    if (!f)
+	return NULL;
+    f->fid = fid;
+    f->direction = r->draw_direction;
+    f->min_char_or_byte2 = r->min_char_or_byte2;
+    f->max_char_or_byte2 = r->max_char_or_byte2;
+    f->min_byte1 = r->min_byte1;
+    f->max_byte1 = r->max_byte1;
+    f->all_chars_exist = r->all_chars_exist;
+    f->default_char = r->default_char;
+    f->min_bounds = CharStructFromInfo (&r->min_bounds);
+    f->max_bounds = CharStructFromInfo (&r->max_bounds);
+    f->ascent = r->font_ascent;
+    f->descent = r->font_descent;
+    const int nci = xcb_query_font_char_infos_length (r);
+    if (nci > 0 && (f->per_char = calloc (nci, sizeof(XCharStruct)))) {
+	const xcb_charinfo_t* ci = xcb_query_font_char_infos (r);
+	for (int i = 0; i < nci; ++i)
+	    f->per_char[i] = CharStructFromInfo (&ci[i]);
+    }
+    return f;
+}
+#endif
+
+//----------------------------------------------------------------------
+// Resources and colors without Xrm or server round trips
+
+static void LoadResources (void)
+{
+    // Xrm would parse the whole database into a tree for the few keys
+    // used here, so only the pinentry-xlib lines are picked out instead.
+    memset (&_res, 0, sizeof(_res));
+    const char* s = XResourceManagerString (_display);
+    if (!s) {
+	// Without RESOURCE_MANAGER, Xlib reads ~/.Xdefaults instead
+	for (unsigned i = 0; i < res_N; ++i) {
+	    const char* v = XGetDefault (_display, PINENTRY_NAME, c_ResourceNames[i]);
+	    if (v)
+		snprintf (_res.v[i], RESOURCE_MAXLEN, "%s", v);
+	}
+	return;
+    }
+    for (const char* l = s; *l;) {
+	const char* e = ResourceLineEnd (l);
+	LoadResourceLine (l, e);
+	l = e + !!*e;
+    }
+}
+
+static const char* ResourceLineEnd (const char* l)
+{
+    // A backslash continues the line past a newline
+    while (*l && *l != '\n') {
+	if (*l == '\\' && l[1])
+	    ++l;
+	++l;
+    }
+    return l;
+}
+
+static void LoadResourceLine (const char* l, const char* e)
+{
+    while (l < e && (*l == ' ' || *l == '\t'))
+	++l;
+    const char* colon = memchr (l, ':', e-l);
+    if (!colon || *l == '!' || *l == '#')
+	return;
+    // Keys are pinentry-xlib.name, pinentry-xlib*name, or *name, in order of precedence
+    const size_t pnl = strlen (PINENTRY_NAME);
+    unsigned prec = 1;
+    if ((size_t)(colon-l) > pnl && !strncmp (l, PINENTRY_NAME, pnl) && (l[pnl] == '.' || l[pnl] == '*')) {
+	prec = 2 + (l[pnl] == '.');
+	l += pnl+1;
+    } else if (*l == '*')
+	++l;
     else
-	_bg = BlackPixel(_display, _screen);
-    // Load font
-    const char* fontname = XGetDefault (_display, PINENTRY_NAME, "font");
-    if (!fontname)
-	fontname = DEFAULT_FONT_NAME;
-    _font = XLoadQueryFont (_display, fontname);
-    // Get Atom ids needed to create a window
-    //{{{ c_AtomNames - parallel to enum
-    static const char* c_AtomNames [a_NAtoms] = {
-	"ATOM",
-	"STRING",
-	"CARDINAL",
-	"WM_CLIENT_MACHINE",
-	"WM_PROTOCOLS",
-	"WM_DELETE_WINDOW",
-	"_NET_WM_PID",
-	"_NET_WM_STATE",
-	"_NET_WM_STATE_NORMAL",
-	"_NET_WM_STATE_MODAL",
-	"_NET_WM_STATE_DEMANDS_ATTENTION",
-	"_NET_WM_STATE_ABOVE",
-	"_NET_WM_WINDOW_TYPE",
-	"_NET_WM_WINDOW_TYPE_DIALOG"
+	return;
+    const char* kend = colon;
+    while (kend > l && (kend[-1] == ' ' || kend[-1] == '\t'))
+	--kend;
+    for (unsigned i = 0; i < res_N; ++i) {
+	if (strlen (c_ResourceNames[i]) != (size_t)(kend-l) || strncmp (l, c_ResourceNames[i], kend-l))
+	    continue;
+	if (prec >= _res.prec[i]) {	// Equal keys: the last one wins, as in Xrm
+	    _res.prec[i] = prec;
+	    UnescapeResourceValue (colon+1, e, _res.v[i]);
+	}
+	break;
+    }
+}
+
+static void UnescapeResourceValue (const char* v, const char* e, char* out)
+{
+    while (v < e && (*v == ' ' || *v == '\t'))
+	++v;
+    size_t n = 0;
+    for (; v < e && n < RESOURCE_MAXLEN-1; ++v) {
+	char c = *v;
+	if (c == '\\' && v+1 < e) {
+	    c = *++v;
+	    if (c == '\n')
+		continue;
+	    else if (c == 'n')
+		c = '\n';
+	    else if (v+2 < e && c >= '0' && c <= '7' && v[1] >= '0' && v[1] <= '7' && v[2] >= '0' && v[2] <= '7') {
+		c = (c-'0')*64 + (v[1]-'0')*8 + (v[2]-'0');
+		v += 2;
+	    }
+	}
+	out[n++] = c;
+    }
+    while (n && (out[n-1] == ' ' || out[n-1] == '\t'))
+	--n;
+    out[n] = 0;
+}
+
+static const char* Resource (unsigned r)
+{
+    return _res.v[r][0] ? _res.v[r] : NULL;
+}
+
+static bool ParseColor (const char* name, XColor* c)
+{
+    // #rgb to #rrrrggggbbbb, scaled as XParseColor does
+    if (name[0] == '#') {
+	const size_t n = strlen (name+1), d = n/3;
+	if (!n || n > 12 || n % 3 || strspn (name+1, "0123456789abcdefABCDEF") != n)
+	    return false;
+	unsigned short v[3];
+	for (unsigned i = 0; i < 3; ++i) {
+	    char hex [5] = {0};
+	    memcpy (hex, name+1+i*d, d);
+	    v[i] = strtoul (hex, NULL, 16) << (16-4*d);
+	}
+	c->red = v[0];
+	c->green = v[1];
+	c->blue = v[2];
+	return true;
+    }
+    // Names match ignoring case and spaces, with grey the same as gray
+    char key [16];
+    size_t n = 0;
+    for (; *name && n < sizeof(key)-1; ++name)
+	if (*name != ' ')
+	    key[n++] = tolower ((unsigned char) *name);
+    if (*name)
+	return false;
+    key[n] = 0;
+    char* grey = strstr (key, "grey");
+    if (grey)
+	grey[2] = 'a';
+    unsigned pct;
+    char* pend;
+    if (!strncmp (key, "gray", 4) && isdigit ((unsigned char) key[4]) && (pct = strtoul (key+4, &pend, 10)) <= 100 && !*pend) {
+	c->red = c->green = c->blue = ((pct*255+50)/100 - (pct == 50 || pct == 90)) * 257;	// Rounded as in rgb.txt
+	return true;
+    }
+    //{{{ c_Colors - from the X rgb.txt
+    static const struct {
+	char	name [14];
+	uint8_t	r, g, b;
+    } c_Colors[] = {
+	{ "black",	0,0,0 },	{ "white",	255,255,255 },
+	{ "red",	255,0,0 },	{ "green",	0,255,0 },
+	{ "blue",	0,0,255 },	{ "yellow",	255,255,0 },
+	{ "cyan",	0,255,255 },	{ "magenta",	255,0,255 },
+	{ "gray",	190,190,190 },	{ "darkgray",	169,169,169 },
+	{ "lightgray",	211,211,211 },	{ "dimgray",	105,105,105 },
+	{ "slategray",	112,128,144 },	{ "darkslategray", 47,79,79 },
+	{ "navy",	0,0,128 },	{ "navyblue",	0,0,128 },
+	{ "darkblue",	0,0,139 },	{ "midnightblue", 25,25,112 },
+	{ "royalblue",	65,105,225 },	{ "steelblue",	70,130,180 },
+	{ "skyblue",	135,206,235 },	{ "lightblue",	173,216,230 },
+	{ "darkred",	139,0,0 },	{ "firebrick",	178,34,34 },
+	{ "darkgreen",	0,100,0 },	{ "forestgreen", 34,139,34 },
+	{ "seagreen",	46,139,87 },	{ "limegreen",	50,205,50 },
+	{ "orange",	255,165,0 },	{ "gold",	255,215,0 },
+	{ "brown",	165,42,42 },	{ "maroon",	176,48,96 },
+	{ "pink",	255,192,203 },	{ "purple",	160,32,240 },
+	{ "orchid",	218,112,214 },	{ "salmon",	250,128,114 },
+	{ "tomato",	255,99,71 },	{ "coral",	255,127,80 },
+	{ "khaki",	240,230,140 },	{ "wheat",	245,222,179 },
+	{ "beige",	245,245,220 },	{ "ivory",	255,255,240 },
+	{ "gainsboro",	220,220,220 },	{ "whitesmoke",	245,245,245 }
     };
     //}}}
-    XInternAtoms (_display, (char**) c_AtomNames, a_NAtoms, false, _atoms);
+    for (unsigned i = 0; i < sizeof(c_Colors)/sizeof(c_Colors[0]); ++i) {
+	if (!strcmp (key, c_Colors[i].name)) {
+	    c->red = c_Colors[i].r * 257;
+	    c->green = c_Colors[i].g * 257;
+	    c->blue = c_Colors[i].b * 257;
+	    return true;
+	}
+    }
+    return false;
+}
+
+static unsigned long ColorChannel (unsigned long mask, unsigned short v)
+{
+    if (!mask)
+	return 0;
+    const unsigned shift = __builtin_ctzl (mask), bits = __builtin_popcountl (mask);
+    return bits >= 16 ? (unsigned long) v << shift & mask : (unsigned long)(v >> (16-bits)) << shift;
+}
+
+static bool ClientSideColor (const char* name, XColor* c)
+{
+    // TrueColor pixels are the color itself, so need no allocation.
+    // Colormapped visuals, and names not in the table, go to the server.
+    const Visual* v = DefaultVisual (_display, _screen);
+    if (v->class != TrueColor || !ParseColor (name, c))
+	return false;
+    c->pixel = ColorChannel (v->red_mask, c->red) | ColorChannel (v->green_mask, c->green) | ColorChannel (v->blue_mask, c->blue);
     return true;
 }
 
-static void CloseX (void)
+static void CloseDisplay (void)
 {
     if (_display) {
 	ClosePinentryWindow();
+	#if __has_include(<X11/extensions/XShm.h>)
+	    FreeGlyphAtlas();
+	#endif
 	if (_font)
 	    XFreeFont (_display, _font);
+	if (_fontAtlas != None)
+	    XFreePixmap (_display, _fontAtlas);
+	#if HAVE_XFT
+	    if (_xftfont) {
+		XftColorFree (_display, DefaultVisual (_display,_screen), DefaultColormap (_display,_screen), &_xftfg);
+		XftFontClose (_display, _xftfont);
+	    }
+	    _xftfont = NULL;
+	#endif
+	++_roundTrips;	// XCloseDisplay syncs
+	CountRoundTrips();
 	XCloseDisplay (_display);
     }
-    if (_displayName)
-	free (_displayName);
-    if (_description)
-	free (_description);
+    _roundTrips = 0;
     _font = NULL;
+    _fontAtlas = None;
     _display = NULL;
-    _displayName = NULL;
-    _description = NULL;
 }
 
-static void OnAlarm (int sig UNUSED)
+static bool IsDisplayCurrent (void)
 {
-    _timedOut = true;
-    // RunMainDialog is stuck in XNextEvent, so need to get the server to send some kind of message
-    XResizeWindow (_display, _w, 1, 1);	// Synchronous calls will flush the fd, so need an async call
+    // A daemon keeps the display open between sessions, each of which may ask for a different one
+    const char* wantName = _displayName ? _displayName : getenv ("DISPLAY");
+    return wantName && 0 == strcmp (wantName, DisplayString (_display));
+}
+
+static void SetEntryTimer (unsigned secs)
+{
+    // Zero disarms the timer; rearming also clears a pending expiration
+    struct itimerspec ts = { .it_value = { .tv_sec = secs } };
+    timerfd_settime (_timerfd, 0, &ts, NULL);
+}
+
+static void GrabServer (void)
+{
+    XGrabServer (_display);
+    _serverGrabStart = NowUsec();
+}
+
+static void UngrabServer (void)
+{
+    // Other clients are blocked until the server sees the ungrab
+    if (!_serverGrabStart)
+	return;
+    XUngrabServer (_display);
     XFlush (_display);
+    _serverGrabUsec += NowUsec() - _serverGrabStart;
+    _serverGrabStart = 0;
+}
+
+static void CountRoundTrips (void)
+{
+    _stats.roundTrips += _roundTrips;
+    _roundTrips = 0;
 }
 
 static int OnXlibError (Display* dpy, XErrorEvent* e)
 {
+    if (_inPrewarm) {	// Replies belong to the main thread; XOpen starts over
+	_prewarmFailed = true;
+	return 0;
+    }
     char errorbuf [512];
     XGetErrorText (dpy, e->error_code, errorbuf, sizeof(errorbuf));
-    printf ("ERR X request %u.%u error: %s\n", e->request_code, e->minor_code, errorbuf);
-    _timedOut = true;
+    if (!_inXDialog) {
+	if (!_pendingXError[0])
+	    snprintf (_pendingXError, sizeof(_pendingXError), "ERR X request %u.%u error: %s", e->request_code, e->minor_code, errorbuf);
+	return 0;
+    }
+    ReplyF ("ERR X request %u.%u error: %s\n", e->request_code, e->minor_code, errorbuf);
+    _dialogFailed = _timedOut = true;
     return 0;
 }
 
 static int OnXlibIOError (Display* dpy UNUSED)
 {
+    if (_inPrewarm) {
+	// Xlib exits if this returns, so only the thread does
+	_prewarmLost = true;
+	_inPrewarm = false;
+	pthread_exit (NULL);
+    }
     _w = None;
     _display = NULL;
-    puts ("ERR connection to X server terminated");
+    ReplyLine ("ERR connection to X server terminated");
+    FlushReplies();
     exit (EXIT_FAILURE);
     return 0;
 }
@@ -221,86 +760,229 @@ static int OnXlibIOError (Display* dpy UNUSED)
 //----------------------------------------------------------------------
 // Pinentry main dialog
 
-bool RunMainDialog (void)
+const dlgbackend_t c_XBackend = { "x11", XOpen, XRunDialog, CloseDisplay, XRenderPath, XPrewarm, FinishPrewarm };
+
+static bool XOpen (void)
 {
-    if (!_display && !OpenX()) {
-	printf ("ERR Unable to open X display %s\n", _displayName);
+    FinishPrewarm();
+    // An error since the last dialog fails this one, as its reply
+    if (_pendingXError[0]) {
+	ReplyLine (_pendingXError);
+	_pendingXError[0] = 0;
+	_dialogFailed = true;
+	return false;
+    }
+    if (_display && !IsDisplayCurrent())
+	CloseDisplay();
+    if (!_display && !OpenX (_displayName)) {
+	ReplyF ("ERR Unable to open X display %s\n", _displayName ? _displayName : "");
+	_dialogFailed = true;
 	return false;
     }
-    CreatePinentryWindow();
+    _inXDialog = true;	// Until XRunDialog returns
+    TracePhase (phase_Connected);
+    return true;
+}
+
+static bool XRunDialog (void)
+{
+    // A daemon keeps serving sessions, so this is not fatal
+    if (_w == None && !CreatePinentryWindow()) {
+	ReplyLine ("ERR No fonts available");
+	_dialogFailed = true;
+	_inXDialog = false;
+	return false;
+    }
+    ShowPinentryWindow();
+    // Time not spent waiting in poll is spent here, or waiting on the server
+    const uint64_t dialogStart = NowUsec();
+    uint64_t waitUsec = 0;
     for (XEvent e; !_timedOut;) {
+	// Draw once all the events received so far are applied
+	if (_redraw != redraw_None && !XEventsQueued (_display, QueuedAfterReading))
+	    RedrawPending();
+	// Wait for X events, the timeout, or commands on the Assuan input
+	if (!XPending (_display)) {	// XPending also flushes the request queue
+	    // Commands may already be buffered, in which case poll would not see them
+	    bool haveInput = _inputFd >= 0 && IsCommandLinePending();
+	    if (!haveInput) {
+		struct pollfd pfd[3] = {
+		    { .fd = ConnectionNumber (_display), .events = POLLIN },
+		    { .fd = _timerfd, .events = POLLIN },
+		    { .fd = _inputFd, .events = POLLIN }
+		};
+		const uint64_t waitStart = NowUsec();
+		const int pr = poll (pfd, 2+(_inputFd >= 0), -1);
+		waitUsec += NowUsec() - waitStart;
+		if (0 > pr) {
+		    if (errno == EINTR)
+			continue;
+		    break;
+		}
+		if (pfd[1].revents) {	// Timed out
+		    ++_stats.timeouts;
+		    break;
+		}
+		haveInput = _inputFd >= 0 && pfd[2].revents;
+	    }
+	    if (haveInput) {
+		edlginput_t r = OnDialogInput();
+		if (r == dlginput_Cancel)
+		    break;
+		else if (r == dlginput_Relayout && _drawn.valid)
+		    RelayoutWindow();
+	    }
+	    if (!XPending (_display))
+		continue;
+	}
 	if (0 > XNextEvent (_display, &e))
 	    break;
+	#if __has_include(<X11/extensions/XShm.h>)
+	    if (_shmCompletion && e.type == _shmCompletion) {
+		_shmBusy = false;
+		continue;
+	    }
+	#endif
 	if (e.xany.window != _w)
 	    continue;
 	if (e.type == ConfigureNotify) {
 	    if (_wwidth != (unsigned) e.xconfigure.width || _wheight != (unsigned) e.xconfigure.height) {
 		_wwidth = e.xconfigure.width;
 		_wheight = e.xconfigure.height;
-		DrawWindow();
+		ResizeCanvas();
+		RequestRedraw (redraw_Full);
 	    }
-	} else if (e.type == Expose) {
+	} else if (e.type == MapNotify)
+	    TracePhase (phase_Mapped);
+	else if (e.type == Expose) {
 	    while (XCheckTypedEvent (_display, Expose, &e)) {}
-	    DrawWindow();
-	    if (_dialogType == PromptForPassword && !_nograb && !_isGrabbed) {
+	    if (!_drawn.valid) {	// The first frame is not held back
+		DrawWindow();
+		TracePhase (phase_Drawn);
+	    } else
+		RequestRedraw (redraw_Full);
+	    if ((_dialogType == PromptForPassword || _dialogType == PromptForPasswords) && !_nograb && !_isGrabbed) {
+		// The keyboard changes hands with the server grabbed, so no other
+		// client can take it in between. The server grab is then kept
+		// while typing, unless only the keyboard grab is wanted.
+		GrabServer();
+		++_roundTrips;
 		if (GrabSuccess != XGrabKeyboard (_display, _w, true, GrabModeAsync, GrabModeAsync, CurrentTime)) {
-		    puts ("ERR failed to grab the keyboard");
+		    ++_stats.grabFailures;
+		    ReplyLine ("ERR failed to grab the keyboard");
+		    _dialogFailed = true;
 		    break;
 		}
 		_isGrabbed = true;
-		XGrabServer (_display);
+		TracePhase (phase_Grabbed);
+		if (_noServerGrab)
+		    UngrabServer();
 	    }
 	} else if (e.type == DestroyNotify) {
 	    _w = None;
 	    break;
 	} else if (e.type == KeyPress) {
+	    const uint64_t keyStart = TraceStart();
+	    if (keyStart && _nTracedKeys < sizeof(_tracedKeys)/sizeof(_tracedKeys[0])) {
+		_tracedKeys[_nTracedKeys].start = keyStart;
+		_tracedKeys[_nTracedKeys++].servertime = e.xkey.time;
+	    }
 	    KeySym ksym = 0;
 	    XLookupString (&e.xkey, NULL, 0, &ksym, NULL);
 	    if (OnKey (ksym))
 		break;
+	    RequestRedraw (redraw_Update);
 	} else if (e.type == ButtonPress
 		|| (e.type == ClientMessage
 		    && (Atom) e.xclient.data.l[0] == _atoms[a_WM_DELETE_WINDOW]))
 	    break;
     }
-    ClosePinentryWindow();
-    const bool r = _accepted;
-    _accepted = false;	// Reset for next time
-    return r;
+    StatsDialogTimes (waitUsec, NowUsec() - dialogStart - waitUsec);
+    if (_w == None)	// Destroyed by someone else
+	ClosePinentryWindow();
+    else
+	HidePinentryWindow();
+    CountRoundTrips();
+    _inXDialog = false;
+    return _accepted;
+}
+
+static const char* XRenderPath (void)
+{
+    return _renderPath;
+}
+
+static void XPrewarm (void)
+{
+    if (_prewarmRunning || _display)
+	return;	// A daemon keeps the display open; XOpen checks if it is still the one wanted
+    if (_displayName) {
+	if ((size_t) snprintf (_prewarmDisplay, sizeof(_prewarmDisplay), "%s", _displayName) >= sizeof(_prewarmDisplay))
+	    return;
+    } else
+	_prewarmDisplay[0] = 0;
+    _prewarmFailed = false;
+    _prewarmRunning = !pthread_create (&_prewarmThread, NULL, PrewarmThread, NULL);
+}
+
+static void* PrewarmThread (void* arg UNUSED)
+{
+    // Everything short of the layout, which uses the session strings
+    // that the main thread may be changing.
+    _inPrewarm = true;
+    if (OpenX (_prewarmDisplay[0] ? _prewarmDisplay : NULL)) {
+	CreatePinentryWindow();
+	// Errors must arrive here, while OnXlibError knows they are for the prewarm
+	XSync (_display, false);
+	++_roundTrips;
+    }
+    _inPrewarm = false;
+    return NULL;
+}
+
+static void FinishPrewarm (void)
+{
+    if (!_prewarmRunning)
+	return;
+    pthread_join (_prewarmThread, NULL);
+    _prewarmRunning = false;
+    ++_stats.connects;
+    _stats.connectUsec += _prewarmConnectUsec;
+    _prewarmConnectUsec = 0;
+    if (_prewarmLost)
+	OnXlibIOError (_display);	// Replies and exits, now on this thread
+    CountRoundTrips();
+    if (_prewarmFailed && _display)
+	CloseDisplay();
 }
 
-static void CreatePinentryWindow (void)
+static bool CreatePinentryWindow (void)
 {
-    _w = XCreateSimpleWindow (_display, RootWindow(_display, _screen), 0, 0, 1, 1, 0, _fg, _bg);
+    // The window is sized by ShowPinentryWindow when the dialog contents are known
+    _wwidth = _wheight = 1;
+    _w = XCreateSimpleWindow (_display, RootWindow(_display, _screen), 0, 0, _wwidth, _wheight, 0, _fg, _bg);
 
     XSelectInput (_display, _w, ExposureMask| KeyPressMask| ButtonPressMask| StructureNotifyMask);
 
     // Create and setup the GC
     _gc = XCreateGC (_display, _w, 0, NULL);
     XSetForeground (_display, _gc, _fg);
+    XSetBackground (_display, _gc, _bg);	// For the built-in font glyph copies
+    XSetGraphicsExposures (_display, _gc, false);
 
+    // The loaded font already has the metrics; the built-in one has them compiled in
     if (_font)
 	XSetFont (_display, _gc, _font->fid);
-    _wfontinfo = XQueryFont (_display, XGContextFromGC (_gc));
-    if (!_wfontinfo) {
-	printf ("ERR No fonts available\n");
-	exit (EXIT_FAILURE);
+    else if (HaveBuiltinFont() && _fontAtlas == None && None == (_fontAtlas = CreateFontAtlas())) {
+	ClosePinentryWindow();
+	return false;
     }
-
-    // Now layout the controls, measuring the actual necessary window size
-    LayoutWindow();
-    XResizeWindow (_display, _w, _wwidth, _wheight);
+    SetFontUnits();
 
     // Setup properties for the window manager
+    XSetStandardProperties (_display, _w, PINENTRY_NAME, PINENTRY_NAME, None, (char**) _argv, _argc, NULL);
     // The size hints
-    XSizeHints szHints;
-    szHints.flags = PMinSize| PMaxSize| PWinGravity;
-    szHints.min_width = _wwidth;
-    szHints.min_height = _wheight;
-    szHints.max_width = _wwidth;
-    szHints.max_height = _wheight;
-    szHints.win_gravity = CenterGravity;
-    XSetStandardProperties (_display, _w, PINENTRY_NAME, PINENTRY_NAME, None, (char**) _argv, _argc, &szHints);
+    SetSizeHints();
     // Hostname
     char hostname [HOST_NAME_MAX];
     if (0 == gethostname (hostname, sizeof(hostname)))
@@ -310,35 +992,56 @@ static void CreatePinentryWindow (void)
     XChangeProperty (_display, _w, _atoms[a_NET_WM_PID], _atoms[a_CARDINAL], 32, PropModeReplace, (const unsigned char*) &pid, 1);
     // WM_PROTOCOLS (to use the close button)
     XChangeProperty (_display, _w, _atoms[a_WM_PROTOCOLS], _atoms[a_ATOM], 32, PropModeReplace, (const unsigned char*) &_atoms[a_WM_DELETE_WINDOW], 1);
-    // That this is a system-wide modal dialog
-    if (!_parentWindow)	// Parent window is only used for the transient for hint. The dialog itself is always a toplevel window, parented to root.
-	_parentWindow = RootWindow (_display, _screen);
-    XSetTransientForHint (_display, _w, _parentWindow);
+    // That this is a system-wide modal dialog; the transient for hint is set when shown
+    _wparent = None;
     // _NET_WM_WINDOW_TYPE set to DIALOG
     XChangeProperty (_display, _w, _atoms[a_NET_WM_WINDOW_TYPE], _atoms[a_ATOM], 32, PropModeReplace, (const unsigned char*) &_atoms[a_NET_WM_WINDOW_TYPE_DIALOG], 1);
     // _NET_WM_STATE set to NORMAL size, MODAL, ABOVE, and DEMANDS_ATTENTION
     XChangeProperty (_display, _w, _atoms[a_NET_WM_STATE], _atoms[a_ATOM], 32, PropModeReplace, (const unsigned char*) &_atoms[a_NET_WM_STATE_NORMAL], 4);
 
-    // Check if DOUBLE-BUFFER extension is available, and if it is, create a backbuffer
-    #if __has_include(<X11/extensions/Xdbe.h>)
-	int dbeMajor, dbeMinor;
-	if (XdbeQueryExtension (_display, &dbeMajor, &dbeMinor) && dbeMajor >= DBE_MAJOR_VERSION)
-	    _d = XdbeAllocateBackBufferName (_display, _w, XdbeBackground);
-    #endif
+    // Create the offscreen drawing surface
+    CreateCanvas();
+    return true;
+}
 
-    // When all of the above is done, map the window
+static void ShowPinentryWindow (void)
+{
+    // The window may be new or reused with all its properties from the
+    // previous dialog; only the size and the parent need to be set.
+    ResizeToLayout();
+    SetTransientFor();
+    _drawn.valid = false;
+    _redraw = redraw_None;
+    _redrawRequests = 0;
+    _nTracedKeys = 0;
+    _serverGrabUsec = 0;
     XMapRaised (_display, _w);
 }
 
+static void HidePinentryWindow (void)
+{
+    UngrabServer();
+    XUngrabKeyboard (_display, CurrentTime);
+    _isGrabbed = false;
+    XWithdrawWindow (_display, _w, _screen);
+    #if __has_include(<X11/extensions/XShm.h>)
+	WaitForShm();
+    #endif
+    // Drop events left from this dialog, like keys typed after Return
+    XSync (_display, true);
+    ++_roundTrips;
+    SetEntryTimer (0);
+    _timedOut = false;
+}
+
 static void ClosePinentryWindow (void)
 {
-    if (_wfontinfo)
-	XFreeFontInfo (NULL, _wfontinfo, 0);
-    _wfontinfo = NULL;
     if (_display) {
-	XUngrabServer (_display);
+	UngrabServer();
 	XUngrabKeyboard (_display, CurrentTime);
 	_isGrabbed = false;
+	if (_w != None)
+	    FreeCanvas();
 	if (_gc != None)
 	    XFreeGC (_display, _gc);
 	if (_w != None)
@@ -346,16 +1049,72 @@ static void ClosePinentryWindow (void)
 	XFlush (_display);
 	_gc = None;
 	_w = None;
+	_wparent = None;
     }
-    alarm (0);	// Cancel entry timeout
+    if (_timerfd >= 0)
+	SetEntryTimer (0);	// Cancel entry timeout
     _timedOut = false;
 }
 
-static void LayoutWindow (void)
+static void SetSizeHints (void)
+{
+    XSizeHints szHints;
+    szHints.flags = PMinSize| PMaxSize| PWinGravity;
+    szHints.min_width = _wwidth;
+    szHints.min_height = _wheight;
+    szHints.max_width = _wwidth;
+    szHints.max_height = _wheight;
+    szHints.win_gravity = CenterGravity;
+    XSetWMNormalHints (_display, _w, &szHints);
+}
+
+static void SetTransientFor (void)
+{
+    // Parent window is only used for the transient for hint. The dialog itself is always a toplevel window, parented to root.
+    const Window parent = _parentWindow ? _parentWindow : RootWindow (_display, _screen);
+    if (parent != _wparent)
+	XSetTransientForHint (_display, _w, parent);
+    _wparent = parent;
+}
+
+static void ResizeToLayout (void)
+{
+    const unsigned oldw = _wwidth, oldh = _wheight;
+    LayoutWindow();
+    if (oldw != _wwidth || oldh != _wheight) {
+	SetSizeHints();
+	XResizeWindow (_display, _w, _wwidth, _wheight);
+	ResizeCanvas();
+    }
+}
+
+static void RelayoutWindow (void)
+{
+    // The contents or rows changed while the dialog is open
+    ResizeToLayout();
+    DrawWindow();
+}
+
+static void SetFontUnits (void)
 {
     // Window is laid out in font units
-    _wl.f.x = _wfontinfo->max_bounds.width;
-    _wl.f.y = _wfontinfo->ascent;
+    #if HAVE_XFT
+	if (_xftfont) {
+	    _wl.f.x = _xftfont->max_advance_width;
+	    _wl.f.y = _xftfont->ascent;
+	} else
+    #endif
+    if (_font) {
+	_wl.f.x = _font->max_bounds.width;
+	_wl.f.y = _font->ascent;
+    } else {
+	_wl.f.x = FONT_W;
+	_wl.f.y = FONT_ASCENT;
+    }
+}
+
+static void LayoutWindow (void)
+{
     _wl.fl.x = 3*_wl.f.x/2;
     _wl.fl.y = 3*_wl.f.y/2;
     // On top is the description of the query
@@ -363,26 +1122,32 @@ static void LayoutWindow (void)
     _wl.desc.y = _wl.f.y;
     _wl.descsz.x = 0;
     _wl.descsz.y = 0;
-    // Measure each line and compute the bounding box
-    for (const char *d = _description, *dend = d+strlen(d), *dlend; d < dend; d = dlend+1) {
-	if (!(dlend = strchr (d, '\n')))
-	    dlend = dend;
-	unsigned lw = XTextWidth (_wfontinfo, d, dlend-d);
-	if (lw > _wl.descsz.x)
-	    _wl.descsz.x = lw;
-	_wl.descsz.y += _wl.fl.y;
+    // The error from the previous attempt, if any, goes above it
+    if (_errorText)
+	LayoutText (_errorText);
+    LayoutText (_description);
+    // Several passphrases each get their description and a box line.
+    // The last box line is laid out as the only one would be.
+    if (_dialogType == PromptForPasswords) {
+	for (unsigned i = 0; i < _multiCount; ++i) {
+	    if (i)
+		_wl.descsz.y += 2*_wl.fl.y;	// For the box line above
+	    _wl.multiline[i] = _wl.descsz.y/_wl.fl.y;
+	    LayoutText (_multiDesc[i]);
+	    _wl.multiboxy[i] = _wl.desc.y+_wl.descsz.y+_wl.fl.y;
+	}
     }
     // Under that is the prompt and the password mask box line
     _wl.prompt.x = _wl.desc.x;
-    _wl.promptw = XTextWidth (_wfontinfo, STRBLK(_prompt));
+    _wl.promptw = TextWidth (STRBLK(_prompt));
     _wl.box.x = _wl.prompt.x+_wl.promptw+_wl.f.x;
     _wl.box.y = _wl.desc.y+_wl.descsz.y+_wl.fl.y;
     _wl.prompt.y = _wl.box.y+_wl.f.y;
     // If confirmation is enabled (new password), add it next
-    if (_confirms > 0) {
+    if (_confirms > 0 && _dialogType == PromptForPassword) {
 	_wl.confirmprompt.x = _wl.prompt.x;
 	_wl.confirmprompt.y = _wl.prompt.y+_wl.fl.y;
-	_wl.confirmpromptw = XTextWidth (_wfontinfo, STRBLK(_confirmPrompt));
+	_wl.confirmpromptw = TextWidth (STRBLK(_confirmPrompt));
 	if (_confirms > 1)
 	    _wl.confirmpromptw += 2*_wl.f.x;	// Add space for confirm count
 	int wider = _wl.confirmpromptw - _wl.promptw;
@@ -410,140 +1175,649 @@ static void LayoutWindow (void)
     _wwidth += 2*_wl.fl.x;	// plus margin
     // Height is the sum of description and the box line, plus margins
     _wheight = _wl.box.y;
-    if (_confirms > 0)
+    if (_confirms > 0 && _dialogType == PromptForPassword)
 	_wheight = _wl.confirmbox.y;
     _wheight += 2*_wl.fl.y;
 }
 
+static void LayoutText (const char* text)
+{
+    // Measure each line and compute the bounding box
+    for (const char *d = text, *dend = d+strlen(d), *dlend; d < dend; d = dlend+1) {
+	if (!(dlend = strchr (d, '\n')))
+	    dlend = dend;
+	unsigned lw = TextWidth (d, dlend-d);
+	if (lw > _wl.descsz.x)
+	    _wl.descsz.x = lw;
+	_wl.descsz.y += _wl.fl.y;
+    }
+}
+
+static void DrawText (const char* text, unsigned* l)
+{
+    for (const char *d = text, *dend = d+strlen(d), *dlend; d < dend; d = dlend+1) {
+	if (!(dlend = strchr (d, '\n')))
+	    dlend = dend;
+	DrawString (_wl.desc.x, _wl.desc.y+(++*l)*_wl.fl.y, d, dlend-d);
+    }
+}
+
+static bool HaveXftFont (void)
+{
+    #if HAVE_XFT
+	return _xftfont;
+    #else
+	return false;
+    #endif
+}
+
+static bool HaveBuiltinFont (void)
+{
+    return !_font && !HaveXftFont();
+}
+
+static unsigned FontGlyph (char c)
+{
+    // Characters not in the built-in font are shown as '?'
+    const unsigned u = (unsigned char) c;
+    return u >= FONT_FIRST && u < FONT_FIRST+FONT_N ? u-FONT_FIRST : '?'-FONT_FIRST;
+}
+
+static Pixmap CreateFontAtlas (void)
+{
+    // The glyphs are uploaded once, side by side in a bitmap, so text is
+    // drawn by copying from it, and the server needs no fonts at all.
+    enum { AW = FONT_N*FONT_W, AWB = (AW+7)/8 };
+    char bits [FONT_H*AWB];
+    memset (bits, 0, sizeof(bits));
+    for (unsigned g = 0; g < FONT_N; ++g) {
+	for (unsigned y = 0; y < FONT_H; ++y) {
+	    for (unsigned x = 0; x < FONT_W; ++x) {
+		const unsigned ax = g*FONT_W + x;
+		if (c_FontGlyphs[g][y] & (1u << x))
+		    bits[y*AWB + ax/8] |= 1u << (ax%8);
+	    }
+	}
+    }
+    return XCreateBitmapFromData (_display, RootWindow (_display, _screen), bits, AW, FONT_H);
+}
+
+static unsigned TextWidth (const char* s, size_t n)
+{
+    #if HAVE_XFT
+	if (_xftfont) {
+	    XGlyphInfo gi;
+	    XftTextExtents8 (_display, _xftfont, (const FcChar8*) s, n, &gi);
+	    return gi.xOff;
+	}
+    #endif
+    if (HaveBuiltinFont())
+	return n*FONT_W;
+    return XTextWidth (_font, s, n);
+}
+
+static void DrawString (unsigned x, unsigned y, const char* s, size_t n)
+{
+    #if __has_include(<X11/extensions/XShm.h>)
+	if (_shmimg) {
+	    ShmDrawString (x, y, s, n);
+	    return;
+	}
+    #endif
+    #if HAVE_XFT
+	if (_xftdraw) {
+	    XftDrawString8 (_xftdraw, &_xftfg, _xftfont, x, y, (const FcChar8*) s, n);
+	    return;
+	}
+    #endif
+    if (HaveBuiltinFont()) {
+	// Set bits of each glyph cell are drawn in the foreground, the rest in the background
+	for (size_t i = 0; i < n; ++i, x += FONT_W)
+	    XCopyPlane (_display, _fontAtlas, _canvas, _gc, FontGlyph (s[i])*FONT_W, 0, FONT_W, FONT_H, x, y-FONT_ASCENT, 1);
+	return;
+    }
+    XDrawString (_display, _canvas, _gc, x, y, s, n);
+}
+
 static void DrawWindow (void)
 {
+    const uint64_t drawStart = NowUsec();
     // Drawing the window indicates activity, so reset the timeout
-    alarm (_entryTimeout);
-    #if __has_include(<X11/extensions/Xdbe.h>)
-	// If a backbuffer is available, then activate it. Will restore _w value at the end of this function.
-	Window wfront = _w;
-	if (_d != None)
-	    _w = _d;
-	else	// Fallthrough to XClearWindow. If using the backbuffer, XdbeBackground clears.
+    SetEntryTimer (_entryTimeout);
+    #if __has_include(<X11/extensions/XShm.h>)
+	WaitForShm();
     #endif
     // Start with a clear window
-    XClearWindow (_display, _w);
+    ClearCanvasArea (0, 0, _wwidth, _wheight);
     // Window border
-    XDrawRectangle (_display, _w, _gc, 1, 1, _wwidth-3, _wheight-3);
-    // Description
+    StrokeRect (1, 1, _wwidth-3, _wheight-3);
+    // Error and description
     unsigned l = 0;
-    for (const char *d = _description, *dend = d+strlen(d), *dlend; d < dend; d = dlend+1) {
-	if (!(dlend = strchr (d, '\n')))
-	    dlend = dend;
-	XDrawString (_display, _w, _gc, _wl.desc.x, _wl.desc.y+(++l)*_wl.fl.y, d, dlend-d);
-    }
+    if (_errorText)
+	DrawText (_errorText, &l);
+    DrawText (_description, &l);
 
     // If just showing a message, the prompt line has accept instructions
     if (_dialogType == ShowMessage)
-	XDrawString (_display, _w, _gc, _wl.prompt.x, _wl.prompt.y, STRBLK(SHOW_MESSAGE_PROMPT));
+	DrawString (_wl.prompt.x, _wl.prompt.y, STRBLK(SHOW_MESSAGE_PROMPT));
     else if (_dialogType == AskYesNoQuestion)
-	XDrawString (_display, _w, _gc, _wl.prompt.x, _wl.prompt.y, STRBLK(ASK_YES_NO_QUESTION_PROMPT));
-    else {
+	DrawString (_wl.prompt.x, _wl.prompt.y, STRBLK(ASK_YES_NO_QUESTION_PROMPT));
+    else if (_dialogType == PromptForPasswords) {
+	for (unsigned i = 0; i < _multiCount; ++i) {
+	    unsigned ml = _wl.multiline[i];
+	    DrawText (_multiDesc[i], &ml);
+	    DrawString (_wl.prompt.x, _wl.multiboxy[i]+_wl.f.y, STRBLK(_prompt));
+	    DrawPasswordBoxLine (_wl.box.x, _wl.multiboxy[i], MultiPasswordLen (i));
+	}
+    } else {
 	// Prompt
-	XDrawString (_display, _w, _gc, _wl.prompt.x, _wl.prompt.y, STRBLK(_prompt));
+	DrawString (_wl.prompt.x, _wl.prompt.y, STRBLK(_prompt));
 	// Password box mask
 	DrawPasswordBoxLine (_wl.box.x, _wl.box.y, _passwordLen);
 
 	// Second line for new passwords
 	if (_confirms) {
 	    if (!_confirmsPass) {	// Quality bar
-		XDrawString (_display, _w, _gc, _wl.confirmprompt.x, _wl.confirmprompt.y, STRBLK(QUALITY_PROMPT));
-		const unsigned quality = ComputeQuality(), barw = (MAX_BOXES-1)*_wl.fl.x+_wl.f.x, barh = _wl.f.y;
-		XDrawRectangle (_display, _w, _gc, _wl.confirmbox.x, _wl.confirmbox.y, barw-1, barh-1);
-		XFillRectangle (_display, _w, _gc, _wl.confirmbox.x, _wl.confirmbox.y, quality*barw/MAX_QUALITY, barh);
-		// Draw good password boundaries.
-		// 56 bits is good enough against a single adversary with a GPU cracker.
-		// 80 bits is good enough for all but the most sensitive stuff
-		enum { BAD_QUALITY = 56, GOOD_QUALITY = 80 };
-		XDrawRectangle (_display, _w, _gc, _wl.confirmbox.x + BAD_QUALITY*barw/MAX_QUALITY, _wl.confirmbox.y,
-						    (GOOD_QUALITY-BAD_QUALITY)*barw/MAX_QUALITY, barh-1);
+		DrawString (_wl.confirmprompt.x, _wl.confirmprompt.y, STRBLK(QUALITY_PROMPT));
+		DrawQualityBar (ComputeQuality());
 	    } else {		// Confirmation prompt and boxes
-		XDrawString (_display, _w, _gc, _wl.confirmprompt.x, _wl.confirmprompt.y, STRBLK(_confirmPrompt));
+		DrawString (_wl.confirmprompt.x, _wl.confirmprompt.y, STRBLK(_confirmPrompt));
 		DrawPasswordBoxLine (_wl.confirmbox.x, _wl.confirmbox.y, _confirmBufLen);
 	    }
 	}
     }
+    _drawn.passwordLen = _passwordLen;
+    _drawn.confirmBufLen = _confirmBufLen;
+    _drawn.confirmsPass = _confirmsPass;
+    _drawn.multiIndex = _multiIndex;
+    _drawn.valid = true;
+    _damage = (XRectangle) { 0, 0, _wwidth, _wheight };
+    PresentCanvas();
+    StatsDraw (NowUsec() - drawStart);
+}
+
+static void UpdateWindow (void)
+{
+    // Typing changes only a box or two and the quality bar,
+    // so redraw just those unless the dialog state changed.
+    if (!_drawn.valid || (_dialogType != PromptForPassword && _dialogType != PromptForPasswords)
+	    || _drawn.confirmsPass != _confirmsPass || _drawn.multiIndex != _multiIndex) {
+	DrawWindow();
+	return;
+    }
+    const uint64_t updateStart = NowUsec();
+    SetEntryTimer (_entryTimeout);
+    #if __has_include(<X11/extensions/XShm.h>)
+	WaitForShm();
+    #endif
+    if (_dialogType == PromptForPasswords)
+	UpdatePasswordBoxLine (_wl.box.x, _wl.multiboxy[_multiIndex], _drawn.passwordLen, _passwordLen);
+    else if (!_confirmsPass) {
+	UpdatePasswordBoxLine (_wl.box.x, _wl.box.y, _drawn.passwordLen, _passwordLen);
+	if (_confirms) {
+	    const unsigned quality = ComputeQuality();
+	    if (quality != _drawn.quality)
+		DrawQualityBar (quality);
+	}
+    } else
+	UpdatePasswordBoxLine (_wl.confirmbox.x, _wl.confirmbox.y, _drawn.confirmBufLen, _confirmBufLen);
+    _drawn.passwordLen = _passwordLen;
+    _drawn.confirmBufLen = _confirmBufLen;
+    PresentCanvas();
+    ++_stats.updates;
+    _stats.updateUsec += NowUsec() - updateStart;
+}
+
+static void RequestRedraw (eredraw_t r)
+{
+    if (_redraw < r)
+	_redraw = r;
+    ++_redrawRequests;
+}
+
+static void RedrawPending (void)
+{
+    if (_redraw == redraw_Full)
+	DrawWindow();
+    else
+	UpdateWindow();
+    _framesSaved += _redrawRequests-1;
+    _redraw = redraw_None;
+    _redrawRequests = 0;
+    if (_nTracedKeys) {
+	// Only traced keys wait for the server to draw them
+	XSync (_display, False);
+	++_roundTrips;
+	for (unsigned i = 0; i < _nTracedKeys; ++i)
+	    TraceKey (_tracedKeys[i].start, _tracedKeys[i].servertime, _nTracedKeys);
+	_nTracedKeys = 0;
+    }
+}
+
+static bool IsBoxFilled (unsigned bx, unsigned pwlen)
+{
+    // Rolling box line; fill boxes until the end, then clear them, then fill again
+    const unsigned vispwlen = pwlen % MAX_BOXES, filldir = (pwlen >> MAX_BOXES_POW) & 1;
+    return (bx < vispwlen) ^ filldir;
+}
+
+static void DrawPasswordBox (unsigned x, unsigned y, bool filled)
+{
+    if (filled)
+	FillRect (x, y, _wl.f.x, _wl.f.y);
+    else
+	StrokeRect (x, y, _wl.f.x-1, _wl.f.y-1);
+}
+
+static void DrawPasswordBoxLine (unsigned x, unsigned y, unsigned pwlen)
+{
+    for (unsigned bx = 0; bx < MAX_BOXES; ++bx)
+	DrawPasswordBox (x+bx*_wl.fl.x, y, IsBoxFilled (bx, pwlen));
+}
+
+static unsigned MultiPasswordLen (unsigned i)
+{
+    // Those entered, the one being entered, then empty ones
+    return i < _multiIndex ? _multiLen[i] : i == _multiIndex ? _passwordLen : 0;
+}
+
+static void UpdatePasswordBoxLine (unsigned x, unsigned y, unsigned oldlen, unsigned pwlen)
+{
+    for (unsigned bx = 0; bx < MAX_BOXES; ++bx) {
+	const bool filled = IsBoxFilled (bx, pwlen);
+	if (filled == IsBoxFilled (bx, oldlen))
+	    continue;
+	const unsigned bxx = x+bx*_wl.fl.x;
+	if (!filled)
+	    ClearCanvasArea (bxx, y, _wl.f.x, _wl.f.y);
+	DrawPasswordBox (bxx, y, filled);
+	AddDamage (bxx, y, _wl.f.x, _wl.f.y);
+    }
+}
+
+static void DrawQualityBar (unsigned quality)
+{
+    const unsigned barw = (MAX_BOXES-1)*_wl.fl.x+_wl.f.x, barh = _wl.f.y;
+    ClearCanvasArea (_wl.confirmbox.x, _wl.confirmbox.y, barw, barh);
+    StrokeRect (_wl.confirmbox.x, _wl.confirmbox.y, barw-1, barh-1);
+    FillRect (_wl.confirmbox.x, _wl.confirmbox.y, quality*barw/MAX_QUALITY, barh);
+    // Draw good password boundaries.
+    // 56 bits is good enough against a single adversary with a GPU cracker.
+    // 80 bits is good enough for all but the most sensitive stuff
+    enum { BAD_QUALITY = 56, GOOD_QUALITY = 80 };
+    StrokeRect (_wl.confirmbox.x + BAD_QUALITY*barw/MAX_QUALITY, _wl.confirmbox.y,
+				(GOOD_QUALITY-BAD_QUALITY)*barw/MAX_QUALITY, barh-1);
+    AddDamage (_wl.confirmbox.x, _wl.confirmbox.y, barw, barh);
+    _drawn.quality = quality;
+}
+
+//----------------------------------------------------------------------
+// Drawing surface management
+
+static void CreateCanvas (void)
+{
+    // Drawing goes to a backbuffer if the DOUBLE-BUFFER extension is available, or
+    // to an offscreen pixmap otherwise. Both keep the last frame for partial updates.
+    _canvas = _w;
+    _renderPath = "window";
+    #if __has_include(<X11/extensions/XShm.h>)
+	// Or to a client-side image; text then needs the glyph atlas
+	if (_shmCompletion && (_atlas.px || BuildGlyphAtlas()) && CreateShmImage()) {
+	    _renderPath = "shm";
+	    _drawn.valid = false;
+	    return;
+	}
+    #endif
+    #if __has_include(<X11/extensions/Xdbe.h>)
+	if (_haveDbe && None != (_d = XdbeAllocateBackBufferName (_display, _w, XdbeCopied))) {
+	    _canvas = _d;
+	    _renderPath = "dbe";
+	} else
+    #endif
+    if (None != (_pix = XCreatePixmap (_display, _w, _wwidth, _wheight, DefaultDepth (_display, _screen)))) {
+	_canvas = _pix;
+	_renderPath = "pixmap";
+    }
+    #if HAVE_XFT
+	if (_xftfont)
+	    _xftdraw = XftDrawCreate (_display, _canvas, DefaultVisual (_display,_screen), DefaultColormap (_display,_screen));
+    #endif
+    _drawn.valid = false;
+}
+
+static void ResizeCanvas (void)
+{
+    #if __has_include(<X11/extensions/XShm.h>)
+	if (_shmimg) {
+	    FreeShmImage();
+	    if (!CreateShmImage()) {	// Continue with server-side drawing
+		_shmCompletion = 0;
+		CreateCanvas();
+	    }
+	    _drawn.valid = false;
+	    return;
+	}
+    #endif
+    if (_pix == None)
+	return;	// The backbuffer is resized with the window
+    XFreePixmap (_display, _pix);
+    _pix = None;
+    _canvas = _w;
+    if (None != (_pix = XCreatePixmap (_display, _w, _wwidth, _wheight, DefaultDepth (_display, _screen))))
+	_canvas = _pix;
+    #if HAVE_XFT
+	if (_xftdraw)
+	    XftDrawChange (_xftdraw, _canvas);
+    #endif
+    _drawn.valid = false;
+}
+
+static void FreeCanvas (void)
+{
+    #if __has_include(<X11/extensions/XShm.h>)
+	FreeShmImage();
+    #endif
+    #if HAVE_XFT
+	if (_xftdraw)
+	    XftDrawDestroy (_xftdraw);
+	_xftdraw = NULL;
+    #endif
+    if (_pix != None)
+	XFreePixmap (_display, _pix);
+    _pix = None;
+    #if __has_include(<X11/extensions/Xdbe.h>)
+	if (_d != None)
+	    XdbeDeallocateBackBufferName (_display, _d);
+	_d = None;
+    #endif
+    _canvas = None;
+    _drawn.valid = false;
+}
+
+static void ClearCanvasArea (unsigned x, unsigned y, unsigned w, unsigned h)
+{
+    #if __has_include(<X11/extensions/XShm.h>)
+	if (_shmimg) {
+	    ShmFillRect (x, y, w, h, _bg);
+	    return;
+	}
+    #endif
+    if (_canvas == _w)
+	XClearArea (_display, _w, x, y, w, h, false);
+    else {
+	XSetForeground (_display, _gc, _bg);
+	XFillRectangle (_display, _canvas, _gc, x, y, w, h);
+	XSetForeground (_display, _gc, _fg);
+    }
+}
+
+static void AddDamage (unsigned x, unsigned y, unsigned w, unsigned h)
+{
+    if (!_damage.width) {
+	_damage = (XRectangle) { x, y, w, h };
+	return;
+    }
+    const unsigned r = x+w > (unsigned) _damage.x+_damage.width ? x+w : (unsigned) _damage.x+_damage.width;
+    const unsigned b = y+h > (unsigned) _damage.y+_damage.height ? y+h : (unsigned) _damage.y+_damage.height;
+    if (x < (unsigned) _damage.x)
+	_damage.x = x;
+    if (y < (unsigned) _damage.y)
+	_damage.y = y;
+    _damage.width = r - _damage.x;
+    _damage.height = b - _damage.y;
+}
+
+static void PresentCanvas (void)
+{
+    if (!_damage.width)
+	return;
+    #if __has_include(<X11/extensions/XShm.h>)
+	if (_shmimg) {
+	    // The server reads the image when it processes the request;
+	    // drawing into it again waits for the completion event.
+	    XShmPutImage (_display, _w, _gc, _shmimg, _damage.x, _damage.y, _damage.x, _damage.y, _damage.width, _damage.height, true);
+	    _shmBusy = true;
+	}
+    #endif
     #if __has_include(<X11/extensions/Xdbe.h>)
 	if (_d != None) {
-	    _w = wfront;
-	    XdbeSwapInfo si = { .swap_window = _w, .swap_action = XdbeBackground };
+	    XdbeSwapInfo si = { .swap_window = _w, .swap_action = XdbeCopied };
 	    XdbeSwapBuffers (_display, &si, 1);
 	}
     #endif
+    if (_pix != None)
+	XCopyArea (_display, _pix, _w, _gc, _damage.x, _damage.y, _damage.width, _damage.height, _damage.x, _damage.y);
+    _damage.width = _damage.height = 0;
 }
 
-static void DrawPasswordBoxLine (unsigned x, unsigned y, unsigned pwlen)
+static void FillRect (unsigned x, unsigned y, unsigned w, unsigned h)
 {
-    const unsigned vispwlen = pwlen % MAX_BOXES, filldir = (pwlen >> MAX_BOXES_POW) & 1;
-    for (unsigned bx = 0; bx < MAX_BOXES; ++bx) {
-	// Rolling box line; fill boxes until the end, then clear them, then fill again
-	if ((bx < vispwlen) ^ filldir)
-	    XFillRectangle (_display, _w, _gc, x+bx*_wl.fl.x, y, _wl.f.x, _wl.f.y);
-	else
-	    XDrawRectangle (_display, _w, _gc, x+bx*_wl.fl.x, y, _wl.f.x-1, _wl.f.y-1);
-    }
-}
-
-static unsigned ComputeQuality (void)
-{
-    // First get the charset size by checking for elements in each subset
-    enum { Numbers = 1, Lowercase = 2, Uppercase = 4, Symbols = 8 };
-    unsigned have = 0;
-    for (unsigned i = 0; i < _passwordLen; ++i) {
-	char c = _password[i];
-	if (c >= '0' && c <= '9')	have |= Numbers;
-	else if (c >= 'a' && c <= 'z')	have |= Lowercase;
-	else if (c >= 'A' && c <= 'Z')	have |= Uppercase;
-	else				have |= Symbols;
-    }
-    // Bits per set is: c_SetCount[] = { 10, 26, 26, 33 };
-    // SetBits is a lookup table of log2(count)*16 (to avoid linking with -lm)
-    // c_SetBits/16 is the set size for each character
-    static const unsigned char c_SetBits[16] = { 0,53,75,83,75,83,91,95,81,87,94,98,94,98,103,105 };
-    unsigned passwordBits = _passwordLen*c_SetBits[have]/16;
-    return passwordBits > MAX_QUALITY ? MAX_QUALITY : passwordBits;
-}
-
-static bool OnKey (wchar_t k)
-{
-    if (k == XK_Return) {
-	if (_confirmsPass++ && 0 != memcmp (_password, _confirmBuf, _passwordLen))
-	    ++_confirms;	// Ask again if does not match
-	const char* confirmfmt = _confirms > 1 ? MULTI_CONFIRM_PROMPT : SINGLE_CONFIRM_PROMPT;
-	snprintf (_confirmPrompt, sizeof(_confirmPrompt), confirmfmt, _confirmsPass);
-	memset (_confirmBuf, 0, sizeof(_confirmBuf));
-	_confirmBufLen = 0;
-	if (_confirmsPass > _confirms) {
-	    _confirmsPass = 0;
-	    return _accepted = true;
+    #if __has_include(<X11/extensions/XShm.h>)
+	if (_shmimg) {
+	    ShmFillRect (x, y, w, h, _fg);
+	    return;
 	}
-    } else if (k == XK_Escape) {
-	_password[_passwordLen = 0] = 0;
-	return true;
-    } else if (k == XK_BackSpace || k == XK_Delete) {
-	if (_confirmsPass > 0) {
-	    if (_confirmBufLen > 0)
-		_confirmBuf[--_confirmBufLen] = 0;
-	} else if (_passwordLen > 0)
-	    _password[--_passwordLen] = 0;
-    } else if (k >= ' ' && k <= '~') {
-	if (_confirmsPass > 0) {
-	    if (_confirmBufLen < sizeof(_confirmBuf)-1) {
-		_confirmBuf[_confirmBufLen] = k;
-		_confirmBuf[++_confirmBufLen] = 0;
-	    }
-	} else {
-	    if (_passwordLen < sizeof(_password)-1) {
-		_password[_passwordLen] = k;
-		_password[++_passwordLen] = 0;
+    #endif
+    XFillRectangle (_display, _canvas, _gc, x, y, w, h);
+}
+
+static void StrokeRect (unsigned x, unsigned y, unsigned w, unsigned h)
+{
+    // Covers the same pixels as XDrawRectangle, w+1 by h+1
+    #if __has_include(<X11/extensions/XShm.h>)
+	if (_shmimg) {
+	    ShmFillRect (x, y, w+1, 1, _fg);
+	    ShmFillRect (x, y+h, w+1, 1, _fg);
+	    ShmFillRect (x, y, 1, h+1, _fg);
+	    ShmFillRect (x+w, y, 1, h+1, _fg);
+	    return;
+	}
+    #endif
+    XDrawRectangle (_display, _canvas, _gc, x, y, w, h);
+}
+
+//----------------------------------------------------------------------
+// Client-side frame through MIT-SHM
+
+#if __has_include(<X11/extensions/XShm.h>)
+
+static bool IsResourceTrue (void)
+{
+    const char* v = Resource (res_shm);
+    return v && (!strcasecmp (v, "true") || !strcasecmp (v, "on") || !strcasecmp (v, "yes") || !strcmp (v, "1"));
+}
+
+static bool BuildGlyphAtlas (void)
+{
+    if (HaveBuiltinFont())
+	return BuildBuiltinGlyphAtlas();
+    // Each glyph is drawn by the server into its own cell of a pixmap,
+    // which is then read back once. ox leaves room for negative bearings.
+    unsigned descent = 0;
+    #if HAVE_XFT
+	if (_xftfont)
+	    descent = _xftfont->descent;
+	else
+    #endif
+    descent = _font->descent;
+    _atlas.ox = _wl.f.x/4;
+    _atlas.cw = _wl.f.x + 2*_atlas.ox;
+    _atlas.ch = _wl.f.y + descent;
+    const unsigned aw = ATLAS_N*_atlas.cw;
+    Pixmap pix = XCreatePixmap (_display, _w, aw, _atlas.ch, DefaultDepth (_display, _screen));
+    if (pix == None)
+	return false;
+    const Drawable canvas = _canvas;
+    _canvas = pix;
+    #if HAVE_XFT
+	if (_xftfont)
+	    _xftdraw = XftDrawCreate (_display, pix, DefaultVisual (_display,_screen), DefaultColormap (_display,_screen));
+    #endif
+    ClearCanvasArea (0, 0, aw, _atlas.ch);
+    for (unsigned i = 0; i < ATLAS_N; ++i) {
+	const char c = ATLAS_FIRST+i;
+	DrawString (i*_atlas.cw + _atlas.ox, _wl.f.y, &c, 1);
+	_atlas.adv[i] = TextWidth (&c, 1);
+    }
+    #if HAVE_XFT
+	if (_xftdraw)
+	    XftDrawDestroy (_xftdraw);
+	_xftdraw = NULL;
+    #endif
+    _canvas = canvas;
+    XImage* img = XGetImage (_display, pix, 0, 0, aw, _atlas.ch, AllPlanes, ZPixmap);
+    ++_roundTrips;
+    XFreePixmap (_display, pix);
+    if (!img)
+	return false;
+    if ((_atlas.px = malloc (aw*_atlas.ch*sizeof(uint32_t))))
+	for (unsigned y = 0; y < _atlas.ch; ++y)
+	    for (unsigned x = 0; x < aw; ++x)
+		_atlas.px[y*aw+x] = XGetPixel (img, x, y);
+    XDestroyImage (img);
+    return _atlas.px;
+}
+
+static bool BuildBuiltinGlyphAtlas (void)
+{
+    // The built-in glyphs are already here, so the server draws nothing
+    _atlas.ox = 0;
+    _atlas.cw = FONT_W;
+    _atlas.ch = FONT_H;
+    const unsigned aw = ATLAS_N*_atlas.cw;
+    if (!(_atlas.px = malloc (aw*_atlas.ch*sizeof(uint32_t))))
+	return false;
+    for (unsigned i = 0; i < ATLAS_N; ++i) {
+	const unsigned g = FontGlyph (ATLAS_FIRST+i);
+	for (unsigned y = 0; y < FONT_H; ++y)
+	    for (unsigned x = 0; x < FONT_W; ++x)
+		_atlas.px[y*aw + i*FONT_W + x] = c_FontGlyphs[g][y] & (1u << x) ? _fg : _bg;
+	_atlas.adv[i] = FONT_W;
+    }
+    return true;
+}
+
+static void FreeGlyphAtlas (void)
+{
+    if (_atlas.px)
+	free (_atlas.px);
+    _atlas.px = NULL;
+}
+
+static int OnShmAttachError (Display* dpy UNUSED, XErrorEvent* e UNUSED)
+{
+    _shmAttachFailed = true;
+    return 0;
+}
+
+static bool CreateShmImage (void)
+{
+    _shmimg = XShmCreateImage (_display, DefaultVisual (_display,_screen), DefaultDepth (_display,_screen), ZPixmap, NULL, &_shminfo, _wwidth, _wheight);
+    if (!_shmimg)
+	return false;
+    // Only 32 bit pixels are drawn client-side; others use the server path
+    if (_shmimg->bits_per_pixel != 32
+	    || 0 > (_shminfo.shmid = shmget (IPC_PRIVATE, _shmimg->bytes_per_line*_shmimg->height, IPC_CREAT| 0600))) {
+	XDestroyImage (_shmimg);
+	_shmimg = NULL;
+	return false;
+    }
+    _shminfo.shmaddr = _shmimg->data = shmat (_shminfo.shmid, NULL, 0);
+    _shminfo.readOnly = true;
+    bool attached = false;
+    if (_shminfo.shmaddr != (char*) -1) {
+	// Attaching fails on remote displays, reported asynchronously as an error
+	XSync (_display, false);
+	int (*oldHandler)(Display*, XErrorEvent*) = XSetErrorHandler (OnShmAttachError);
+	_shmAttachFailed = false;
+	XShmAttach (_display, &_shminfo);
+	XSync (_display, false);
+	_roundTrips += 2;
+	XSetErrorHandler (oldHandler);
+	attached = !_shmAttachFailed;
+    }
+    shmctl (_shminfo.shmid, IPC_RMID, NULL);	// Freed when both sides detach
+    if (!attached) {
+	if (_shminfo.shmaddr != (char*) -1)
+	    shmdt (_shminfo.shmaddr);
+	_shmimg->data = NULL;
+	XDestroyImage (_shmimg);
+	_shmimg = NULL;
+	_shminfo.shmid = -1;
+	_shmCompletion = 0;	// Do not try again on this connection
+	return false;
+    }
+    return true;
+}
+
+static void FreeShmImage (void)
+{
+    if (!_shmimg)
+	return;
+    WaitForShm();
+    XShmDetach (_display, &_shminfo);
+    shmdt (_shminfo.shmaddr);
+    _shmimg->data = NULL;
+    XDestroyImage (_shmimg);
+    _shmimg = NULL;
+    _shminfo.shmid = -1;
+}
+
+static Bool IsShmCompletion (Display* dpy UNUSED, XEvent* e, XPointer arg UNUSED)
+{
+    return e->type == _shmCompletion;
+}
+
+static void WaitForShm (void)
+{
+    if (!_shmBusy)
+	return;
+    XEvent e;
+    XIfEvent (_display, &e, IsShmCompletion, NULL);
+    ++_roundTrips;	// Waited for like a reply
+    _shmBusy = false;
+}
+
+static void ShmFillRect (unsigned x, unsigned y, unsigned w, unsigned h, unsigned long color)
+{
+    const unsigned iw = _shmimg->width, ih = _shmimg->height;
+    if (x >= iw || y >= ih)
+	return;
+    if (w > iw-x)
+	w = iw-x;
+    if (h > ih-y)
+	h = ih-y;
+    for (unsigned r = 0; r < h; ++r) {
+	uint32_t* p = (uint32_t*) (_shmimg->data + (y+r)*_shmimg->bytes_per_line) + x;
+	for (unsigned c = 0; c < w; ++c)
+	    p[c] = color;
+    }
+}
+
+static void ShmDrawString (unsigned x, unsigned y, const char* s, size_t n)
+{
+    // Copies the non-background pixels of each glyph cell
+    const int iw = _shmimg->width, ih = _shmimg->height;
+    const unsigned aw = ATLAS_N*_atlas.cw;
+    int gx = (int) x - _atlas.ox;
+    const int gy = (int) y - _wl.f.y;
+    for (size_t i = 0; i < n; ++i) {
+	unsigned c = (unsigned char) s[i];
+	c = c < ATLAS_FIRST ? '?'-ATLAS_FIRST : c-ATLAS_FIRST;
+	for (unsigned r = 0; r < _atlas.ch; ++r) {
+	    const int dy = gy + (int) r;
+	    if (dy < 0 || dy >= ih)
+		continue;
+	    uint32_t* drow = (uint32_t*) (_shmimg->data + dy*_shmimg->bytes_per_line);
+	    const uint32_t* srow = &_atlas.px[r*aw + c*_atlas.cw];
+	    for (unsigned k = 0; k < _atlas.cw; ++k) {
+		const int dx = gx + (int) k;
+		if (dx >= 0 && dx < iw && srow[k] != _bg)
+		    drow[dx] = srow[k];
 	    }
 	}
+	gx += _atlas.adv[c];
     }
-    DrawWindow();
-    return false;
 }
+
+#endif
@@ -11,35 +11,115 @@
 
 enum {
     PASSWORD_MAXLEN = 128,
-    PROMPT_MAXLEN = 16
+    PROMPT_MAXLEN = 16,
+    MULTI_MAX = 8,
+    MAX_QUALITY = 128
 };
 
+// Keys understood by OnKey, in addition to printable ASCII.
+// The values are the X keysyms, so the X backend passes those unchanged.
+enum {
+    key_BackSpace = 0xff08,
+    key_Return = 0xff0d,
+    key_Escape = 0xff1b,
+    key_Delete = 0xffff
+};
+
+// A string that is not zero-terminated, as a part of a command line
+typedef struct {
+    const char*	p;
+    size_t	n;
+} strblk_t;
+
 typedef enum {
     PromptForPassword,
+    PromptForPasswords,	// One for each SETMULTI description
     ShowMessage,
     AskYesNoQuestion
 } edlgtype_t;
 
+// What to do with the open dialog after OnDialogInput
+typedef enum {
+    dlginput_Continue,
+    dlginput_Relayout,	// The dialog contents or rows changed
+    dlginput_Cancel
+} edlginput_t;
+
+// A dialog implementation. RunMainDialog calls Open before each dialog,
+// then RunDialog, which feeds keys to OnKey until it returns true. Close
+// is called at exit and releases whatever Open kept between dialogs.
+// RenderPath names the way the last dialog was drawn. Prewarm, if not
+// NULL, starts the work of Open in the background, and FinishPrewarm
+// waits for it to end.
+typedef struct {
+    const char*	name;
+    bool	(*Open)(void);
+    bool	(*RunDialog)(void);
+    void	(*Close)(void);
+    const char*	(*RenderPath)(void);
+    void	(*Prewarm)(void);
+    void	(*FinishPrewarm)(void);
+} dlgbackend_t;
+
 //----------------------------------------------------------------------
 
 // Parameters for X window creation
-extern char* _displayName;
+extern const char* _displayName;
 extern int _argc;
 extern const char* const* _argv;
 
 // Pinentry dialog parameters
 extern edlgtype_t _dialogType;
-extern char* _description;
+extern const char* _description;
+extern const char* _errorText;
 extern char _prompt [PROMPT_MAXLEN];
 extern unsigned _confirms;
 extern unsigned _parentWindow;
 extern unsigned _entryTimeout;
 extern bool _nograb;
+extern bool _noServerGrab;	// Grab the server only while grabbing the keyboard
 
-// Dialog return value
-extern char _password [PASSWORD_MAXLEN];
+// Commands arriving on this fd while a dialog is open are passed to
+// OnDialogInput. -1 when there is no protocol input, as for ssh-askpass.
+extern int _inputFd;
+
+// Dialog return value, PASSWORD_MAXLEN bytes in the secure arena
+extern char* _password;
 extern size_t _passwordLen;
 
+// Entry state for drawing the confirmation line
+extern char _confirmPrompt [PROMPT_MAXLEN];
+extern char* _confirmBuf;
+extern size_t _confirmBufLen;
+extern unsigned _confirmsPass;
+extern bool _accepted;
+extern bool _dialogFailed;	// An ERR was replied instead of the dialog result
+
+// Passphrases asked together, each under its own description. They are
+// entered into _password one at a time, and moved to _multiPasswords.
+extern const char* _multiDesc [MULTI_MAX];
+extern unsigned _multiCount;
+extern unsigned _multiIndex;	// The one being entered
+extern char* _multiPasswords;	// MULTI_MAX*PASSWORD_MAXLEN bytes in the secure arena
+extern size_t _multiLen [MULTI_MAX];
+extern unsigned long _serverGrabUsec;	// How long the last dialog blocked other X clients
+extern unsigned long _framesSaved;	// Redraws merged into others, since start
+
+// Backends
+extern const dlgbackend_t c_XBackend;
+extern const dlgbackend_t c_HeadlessBackend;
+
 //----------------------------------------------------------------------
 
 bool RunMainDialog (void);
+bool KeepEntryBuffers (void);	// Allocates _password, if not yet done
+void PrewarmDialog (void);
+void FinishPrewarmDialog (void);	// Before changing what the prewarm uses
+const char* DialogRenderPath (void);
+
+// Used by backends
+bool OnKey (unsigned k);
+unsigned ComputeQuality (void);
+
+// Implemented by the protocol side
+edlginput_t OnDialogInput (void);